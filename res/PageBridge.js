@@ -0,0 +1,49 @@
+// Injected by PageBridge after qwebchannel.js: pushes the web app's timer, recent tasks and API token
+// to the desktop app whenever an Angular digest changes them, instead of the app polling for them.
+(function () {
+    if (typeof qt === 'undefined' || typeof qt.webChannelTransport === 'undefined' || window.timecampBridgeStarted) {
+        return;
+    }
+    window.timecampBridgeStarted = true;
+
+    new QWebChannel(qt.webChannelTransport, function (channel) {
+        var bridge = channel.objects.timecamp;
+
+        function watchApp(attempt) {
+            var injector = typeof angular !== 'undefined' && angular.element(document.body).injector();
+            if (!injector) {
+                // the app bootstraps after DocumentReady; give up after ~20 s (login pages have no app)
+                if (attempt < 20) {
+                    setTimeout(function () { watchApp(attempt + 1); }, Math.min(250 * (attempt + 1), 2000));
+                }
+                return;
+            }
+            var $rootScope = injector.get('$rootScope');
+            var timerService = injector.has('TimerService') ? injector.get('TimerService') : null;
+
+            if (timerService) {
+                $rootScope.$watch(function () {
+                    return timerService.timer;
+                }, function (timer) {
+                    bridge.pushTimer(JSON.stringify(timer));
+                }, true);
+            }
+            $rootScope.$watch(function () {
+                return typeof TC !== 'undefined' && TC.TimeTracking ? TC.TimeTracking.Lasts : undefined;
+            }, function (lasts) {
+                if (typeof lasts !== 'undefined') {
+                    bridge.pushRecentTasks(JSON.stringify(lasts));
+                }
+            }, true);
+            $rootScope.$watch(function () {
+                return typeof window.apiService !== 'undefined' ? window.apiService.getToken().$$state.value : undefined;
+            }, function (token) {
+                if (token) {
+                    bridge.pushToken(String(token));
+                }
+            });
+        }
+
+        watchApp(0);
+    });
+})();
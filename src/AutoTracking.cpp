@@ -1,9 +1,12 @@
 #include "AutoTracking.h"
 #include <QtCore/QDateTime>
-#include <QtCore/QSettings>
 #include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
 #include "DbManager.h"
-#include "Settings.h"
+#include "SettingsSnapshot.h"
+#include "LogCategories.h"
+#include "Metrics.h"
+#include "Tracing.h"
 
 AutoTracking &AutoTracking::instance() {
     static AutoTracking _instance;
@@ -11,57 +14,121 @@ AutoTracking &AutoTracking::instance() {
 }
 
 void AutoTracking::checkAppKeywords(AppData *app) {
+    TRACE_SCOPE("AutoTracking::checkAppKeywords");
 
-    QSettings settings;
-    bool autoTracking = settings.value(SETT_TRACK_AUTO_SWITCH, false).toBool();
-    if(autoTracking) {
-        Task *matchedTask = this->matchActivityToTaskKeywords(app);
+    if(SettingsService::instance().current().autoTracking) {
+        static MetricHistogram &matchTime = Metrics::instance().histogram("autotracking_match_us", "Matching one activity to task rules");
+        MetricTimer timer(matchTime);
+        TaskPtr matchedTask = this->matchActivityToTaskKeywords(app);
         if (matchedTask != nullptr) {
             emit foundTask(matchedTask, false);
         }
     }
 }
 
-Task *AutoTracking::matchActivityToTaskKeywords(AppData *app) {
+TaskPtr AutoTracking::matchActivityToTaskKeywords(AppData *app) {
     qint64 now = QDateTime::currentMSecsSinceEpoch();
     if (now > lastUpdate + taskUpdateThreshold) { // if we're past X minutes since last task update
 
-        // insert AppData into a List
-        QStringList dataItems;
-        dataItems.push_back(app->getAppName());
-        dataItems.push_back(app->getWindowName());
-        dataItems.push_back(app->getAdditionalInfo());
-
-        for (Task *task: DbManager::instance().getTaskList()) { // in every task
-            QStringList taskKeywords = task->getKeywordsList(); // get the KW
-            if (!taskKeywords.isEmpty()) { // and if we have KW
-                for (const QString &dataWithPotentialKeyword: dataItems) { // in every appdata
-                    for (const QString &keyword: taskKeywords) { // check each keyword
-                        if (dataWithPotentialKeyword.contains(keyword,
-                                                              Qt::CaseInsensitive)) { // and if data contains keyword
-                            lastUpdate = now;
-                            qDebug() << "Task matched: " << task->getName();
-                            qDebug() << "Keyword found: " << keyword;
-                            qDebug() << "In data: " << dataWithPotentialKeyword;
-                            qDebug() << "Task ID: " << task->getTaskId();
-                            return task; // return task
-                        }
-                    }
-                }
+        // people keep coming back to the same few windows, so remember what they matched
+        ActivityKey key{app->getAppName().trimmed(), app->getWindowName().trimmed(), app->getAdditionalInfo().trimmed()};
+        TaskRuleEngine::Match match;
+        if (const TaskRuleEngine::Match *cached = matchCache.object(key)) {
+            static MetricCounter &cacheHits = Metrics::instance().counter("autotracking_cache_hits_total", "Activities matched from the cache");
+            cacheHits.add();
+            matchCacheHits++;
+            match = *cached;
+        } else {
+            static MetricCounter &cacheMisses = Metrics::instance().counter("autotracking_cache_misses_total", "Activities matched by evaluating the rules");
+            cacheMisses.add();
+            matchCacheMisses++;
+            // every field is looked at once, however many rules there are; the best scoring rule wins
+            match = ruleEngine->evaluate(key.appName, key.windowTitle, key.url);
+            matchCache.insert(key, new TaskRuleEngine::Match(match));
+        }
+
+        if (match.taskId >= 0) {
+            TaskPtr task = DbManager::instance().getTaskById(match.taskId);
+            if (task != nullptr) {
+                lastUpdate = now;
+                qCDebug(lcActivity) << "Task matched: " << task->getName();
+                qCDebug(lcActivity) << "Rule matched: " << ruleEngine->rule(match).source;
+                qCDebug(lcActivity) << "In field: " << TaskRuleEngine::fieldName(match.field);
+                qCDebug(lcActivity) << "Task ID: " << task->getTaskId();
+                return task;
             }
         }
     }
     return nullptr;
 }
 
-AutoTracking::AutoTracking(QObject *parent) : QObject(parent) {
+AutoTracking::CompiledRules AutoTracking::compileRules(const TaskCatalogPtr &catalog, const QHash<qint64, QString> &previousKeywords) {
+    CompiledRules compiled;
+    compiled.keywords.reserve(catalog->size());
+    for (const TaskPtr &task: catalog->tasks()) {
+        if (!task->getKeywords().isEmpty()) {
+            compiled.keywords.insert(task->getTaskId(), task->getKeywords());
+        }
+    }
+    if (compiled.keywords == previousKeywords) {
+        return compiled; // task list refreshed, but no rule changed
+    }
 
+    auto engine = std::make_shared<TaskRuleEngine>();
+    engine->setTasks(catalog->tasks());
+    compiled.engine = std::move(engine);
+    return compiled;
+}
+
+void AutoTracking::updateTaskRules() {
+    // with tens of thousands of tasks this takes a while, so it doesn't run on the GUI thread;
+    // a newer task list replaces one still being compiled, its result is never used
+    rulesPending = true;
+    rulesWatcher.setFuture(QtConcurrent::run(&AutoTracking::compileRules, DbManager::instance().getTaskCatalog(), compiledKeywords));
+}
+
+void AutoTracking::applyTaskRules() {
+    if (!rulesPending) {
+        return;
+    }
+    rulesPending = false;
+    CompiledRules compiled = rulesWatcher.result();
+    if (!compiled.engine) {
+        return;
+    }
+
+    ruleEngine = compiled.engine;
+    compiledKeywords = compiled.keywords;
+    if (matchCacheHits + matchCacheMisses > 0) {
+        qDebug() << "[AutoTracking] Match cache:" << matchCacheHits << "hits," << matchCacheMisses << "misses, cleared";
+    }
+    matchCache.clear();
+    qDebug() << "[AutoTracking] Compiled" << ruleEngine->rules().size() << "rules of" << compiledKeywords.size() << "tasks";
+}
+
+void AutoTracking::waitForTaskRules() {
+    rulesWatcher.waitForFinished();
+    applyTaskRules();
+}
+
+AutoTracking::AutoTracking(QObject *parent) : QObject(parent), ruleEngine(std::make_shared<const TaskRuleEngine>()) {
+    connect(&rulesWatcher, &QFutureWatcherBase::finished, this, &AutoTracking::applyTaskRules);
+    connect(&DbManager::instance(), &DbManager::taskListChanged, this, &AutoTracking::updateTaskRules);
+    updateTaskRules();
 }
 
 qint64 AutoTracking::getLastUpdate() const {
     return lastUpdate;
 }
 
+quint64 AutoTracking::getMatchCacheHits() const {
+    return matchCacheHits;
+}
+
+quint64 AutoTracking::getMatchCacheMisses() const {
+    return matchCacheMisses;
+}
+
 void AutoTracking::setLastUpdate(qint64 lastUpdate) {
     AutoTracking::lastUpdate = lastUpdate;
 }
@@ -2,11 +2,14 @@
 #define TIMECAMPDESKTOP_AUTOTRACKING_H
 
 
+#include <QCache>
+#include <QFutureWatcher>
 #include <QObject>
 #include <QString>
 #include <QtCore/QVector>
 #include "Task.h"
 #include "AppData.h"
+#include "TaskRuleEngine.h"
 
 class AutoTracking: public QObject
 {
@@ -16,21 +19,64 @@ Q_OBJECT
     int taskUpdateThreshold = 30 * 1000; // in ms; prompt every X sec
     qint64 lastUpdate = 0;
 
+    struct CompiledRules
+    {
+        std::shared_ptr<const TaskRuleEngine> engine; // null when the keywords didn't change
+        QHash<qint64, QString> keywords; // taskID -> keywords the rules were compiled from
+    };
+
+    std::shared_ptr<const TaskRuleEngine> ruleEngine; // rules from the keywords of all tasks
+    QHash<qint64, QString> compiledKeywords;
+    // rules are compiled on the thread pool, and swapped in on this object's thread when ready
+    QFutureWatcher<CompiledRules> rulesWatcher;
+    bool rulesPending = false;
+
+    static CompiledRules compileRules(const TaskCatalogPtr &catalog, const QHash<qint64, QString> &previousKeywords);
+
+    struct ActivityKey
+    {
+        QString appName;
+        QString windowTitle;
+        QString url;
+
+        bool operator==(const ActivityKey &other) const
+        {
+            return appName == other.appName && windowTitle == other.windowTitle && url == other.url;
+        }
+
+        friend uint qHash(const ActivityKey &key, uint seed = 0)
+        {
+            return qHash(key.appName, seed) ^ qHash(key.windowTitle, seed * 31 + 1) ^ qHash(key.url, seed * 131 + 2);
+        }
+    };
+
+    // the last activities seen and what they matched (taskId -1 for no match); cleared whenever the rules change
+    QCache<ActivityKey, TaskRuleEngine::Match> matchCache{512};
+    quint64 matchCacheHits = 0;
+    quint64 matchCacheMisses = 0;
+
 protected:
     explicit AutoTracking(QObject *parent = nullptr);
 
 public:
     static AutoTracking &instance();
     qint64 getLastUpdate() const;
+    quint64 getMatchCacheHits() const;
+    quint64 getMatchCacheMisses() const;
 
-    Task *matchActivityToTaskKeywords(AppData *app);
+    TaskPtr matchActivityToTaskKeywords(AppData *app);
+    void waitForTaskRules(); // blocks until rules being compiled are in use
 
 public slots:
     void checkAppKeywords(AppData *app);
     void setLastUpdate(qint64 lastUpdate);
+    void updateTaskRules();
+
+private slots:
+    void applyTaskRules();
 
 signals:
-    void foundTask(Task *matchedTask, bool force);
+    void foundTask(TaskPtr matchedTask, bool force);
 };
 
 
@@ -0,0 +1,313 @@
+#include "BinaryLog.h"
+
+#include <cstring>
+
+#include <QtEndian>
+
+// a new file after this many distinct strings (or bytes of them)
+static const quint32 BLOG_MAX_STRINGS = 64 * 1024;
+static const qint64 BLOG_MAX_STRING_BYTES = 2 * 1024 * 1024;
+
+// the biggest number that is stored as an argument; longer digit runs stay in the text
+static const int BLOG_MAX_DIGITS = 18;
+
+static inline bool isAsciiDigit(QChar c)
+{
+    return c.unicode() >= '0' && c.unicode() <= '9';
+}
+
+namespace BinaryLog
+{
+    void splitNumbers(const QString &message, QString &format, QVector<quint64> &args)
+    {
+        format.clear();
+        args.clear();
+        const int size = message.size();
+        for (int i = 0; i < size; i++) {
+            QChar c = message[i];
+            if (c == QLatin1Char('%')) {
+                format += QLatin1String("%%");
+                continue;
+            }
+            if (!isAsciiDigit(c)) {
+                format += c;
+                continue;
+            }
+
+            int end = i + 1;
+            while (end < size && isAsciiDigit(message[end])) {
+                end++;
+            }
+            int length = end - i;
+            if (args.size() < BLOG_MAX_ARGS && length <= BLOG_MAX_DIGITS && (length == 1 || c != QLatin1Char('0'))) {
+                quint64 value = 0;
+                for (int d = i; d < end; d++) {
+                    value = value * 10 + (message[d].unicode() - '0');
+                }
+                args.append(value);
+                format += QLatin1String("%d");
+            } else {
+                format += message.midRef(i, length);
+            }
+            i = end - 1;
+        }
+    }
+
+    QString joinNumbers(const QString &format, const QVector<quint64> &args)
+    {
+        QString message;
+        message.reserve(format.size() + args.size() * 4);
+        int arg = 0;
+        const int size = format.size();
+        for (int i = 0; i < size; i++) {
+            if (format[i] == QLatin1Char('%') && i + 1 < size) {
+                QChar next = format[i + 1];
+                if (next == QLatin1Char('%')) {
+                    message += QLatin1Char('%');
+                    i++;
+                    continue;
+                }
+                if (next == QLatin1Char('d') && arg < args.size()) {
+                    message += QString::number(args[arg++]);
+                    i++;
+                    continue;
+                }
+            }
+            message += format[i];
+        }
+        return message;
+    }
+
+    const char *levelName(QtMsgType type)
+    {
+        switch (type) {
+            case QtDebugMsg:
+                return "Debug";
+            case QtInfoMsg:
+                return "Info";
+            case QtWarningMsg:
+                return "Warning";
+            case QtCriticalMsg:
+                return "Critical";
+            case QtFatalMsg:
+                return "Fatal";
+        }
+        return "Unknown";
+    }
+}
+
+QByteArray BinaryLogEncoder::begin(qint64 msSinceEpoch)
+{
+    formatIds.clear();
+    categoryIds.clear();
+    stringCount = 0;
+    stringBytes = 0;
+    lastEventMs = msSinceEpoch;
+
+    QByteArray header(BLOG_MAGIC, BLOG_MAGIC_SIZE);
+    char start[8];
+    qToLittleEndian<qint64>(msSinceEpoch, reinterpret_cast<uchar *>(start));
+    header.append(start, sizeof(start));
+    return header;
+}
+
+void BinaryLogEncoder::appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+quint32 BinaryLogEncoder::defineString(QByteArray &out, const QByteArray &utf8)
+{
+    out.append(static_cast<char>(BLOG_TAG_STRING));
+    appendVarint(out, static_cast<quint64>(utf8.size()));
+    out.append(utf8);
+    stringBytes += utf8.size();
+    return stringCount++;
+}
+
+void BinaryLogEncoder::appendEvent(QByteArray &out, qint64 msSinceEpoch, QtMsgType type, const char *category,
+                                   const QString &message)
+{
+    // strings have to be defined before the event that uses them
+    const char *categoryName = category != nullptr ? category : "default";
+    QByteArray categoryKey = QByteArray::fromRawData(categoryName, static_cast<int>(std::strlen(categoryName)));
+    auto categoryFound = categoryIds.constFind(categoryKey);
+    quint32 categoryId;
+    if (categoryFound != categoryIds.constEnd()) {
+        categoryId = categoryFound.value();
+    } else {
+        QByteArray name(categoryName); // a deep copy, the key has to outlive the message
+        categoryId = defineString(out, name);
+        categoryIds.insert(name, categoryId);
+    }
+
+    BinaryLog::splitNumbers(message, format, args);
+    auto formatFound = formatIds.constFind(format);
+    quint32 formatId;
+    if (formatFound != formatIds.constEnd()) {
+        formatId = formatFound.value();
+    } else {
+        formatId = defineString(out, format.toUtf8());
+        formatIds.insert(format, formatId);
+    }
+
+    qint64 delta = msSinceEpoch - lastEventMs; // negative when the clock was set back
+    lastEventMs = msSinceEpoch;
+
+    out.append(static_cast<char>(BLOG_TAG_EVENT));
+    out.append(static_cast<char>(type));
+    appendVarint(out, (static_cast<quint64>(delta) << 1) ^ static_cast<quint64>(delta >> 63));
+    appendVarint(out, categoryId);
+    appendVarint(out, formatId);
+    appendVarint(out, static_cast<quint64>(args.size()));
+    for (quint64 arg : qAsConst(args)) {
+        appendVarint(out, arg);
+    }
+}
+
+void BinaryLogEncoder::appendRepeat(QByteArray &out, quint64 count)
+{
+    out.append(static_cast<char>(BLOG_TAG_REPEAT));
+    appendVarint(out, count);
+}
+
+bool BinaryLogEncoder::isFull() const
+{
+    return stringCount >= BLOG_MAX_STRINGS || stringBytes >= BLOG_MAX_STRING_BYTES;
+}
+
+BinaryLogReader::BinaryLogReader(const QString &path)
+    : file(path)
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return;
+    }
+    QByteArray header = file.read(BLOG_MAGIC_SIZE + 8);
+    if (header.size() != BLOG_MAGIC_SIZE + 8 || !header.startsWith(QByteArray(BLOG_MAGIC, BLOG_MAGIC_SIZE))) {
+        error = "Not a binary log";
+        file.close();
+        return;
+    }
+    startMs = qFromLittleEndian<qint64>(reinterpret_cast<const uchar *>(header.constData() + BLOG_MAGIC_SIZE));
+    lastEventMs = startMs;
+}
+
+bool BinaryLogReader::isBinaryLog(const QString &path)
+{
+    QFile logFile(path);
+    if (!logFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return logFile.read(BLOG_MAGIC_SIZE) == QByteArray(BLOG_MAGIC, BLOG_MAGIC_SIZE);
+}
+
+bool BinaryLogReader::isOpen() const
+{
+    return file.isOpen();
+}
+
+qint64 BinaryLogReader::startedAt() const
+{
+    return startMs;
+}
+
+QString BinaryLogReader::errorString() const
+{
+    return error;
+}
+
+bool BinaryLogReader::readVarint(quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        char byte;
+        if (!file.getChar(&byte)) {
+            return false;
+        }
+        value |= static_cast<quint64>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false; // longer than any varint we write - corrupted file
+}
+
+bool BinaryLogReader::readString(quint64 id, QString &string) const
+{
+    if (id >= static_cast<quint64>(strings.size())) {
+        return false;
+    }
+    string = strings.at(static_cast<int>(id));
+    return true;
+}
+
+bool BinaryLogReader::readNext(BinaryLogEvent &event)
+{
+    char tag;
+    while (file.isOpen() && file.getChar(&tag)) {
+        if (tag == BLOG_TAG_STRING) {
+            quint64 length;
+            if (!readVarint(length)) {
+                error = "The log ends in the middle of a record";
+                return false;
+            }
+            QByteArray utf8 = file.read(static_cast<qint64>(length));
+            if (static_cast<quint64>(utf8.size()) != length) {
+                error = "The log ends in the middle of a record";
+                return false;
+            }
+            strings.append(QString::fromUtf8(utf8));
+        } else if (tag == BLOG_TAG_EVENT) {
+            char level;
+            quint64 delta, categoryId, formatId, argCount;
+            if (!file.getChar(&level) || !readVarint(delta) || !readVarint(categoryId) || !readVarint(formatId)
+                || !readVarint(argCount) || argCount > BLOG_MAX_ARGS) {
+                error = "The log ends in the middle of a record";
+                return false;
+            }
+            QVector<quint64> args(static_cast<int>(argCount));
+            for (quint64 &arg : args) {
+                if (!readVarint(arg)) {
+                    error = "The log ends in the middle of a record";
+                    return false;
+                }
+            }
+            QString format;
+            if (!readString(categoryId, event.category) || !readString(formatId, format)) {
+                error = "An event uses an undefined string, the log is corrupted";
+                return false;
+            }
+            lastEventMs += static_cast<qint64>(delta >> 1) ^ -static_cast<qint64>(delta & 1);
+            event.msSinceEpoch = lastEventMs;
+            event.type = static_cast<QtMsgType>(level);
+            event.message = BinaryLog::joinNumbers(format, args);
+            event.repeated = 0;
+
+            // a repeat record belongs to the event before it
+            char nextTag;
+            if (file.peek(&nextTag, 1) == 1 && nextTag == BLOG_TAG_REPEAT) {
+                file.getChar(&nextTag);
+                if (!readVarint(event.repeated)) {
+                    error = "The log ends in the middle of a record";
+                    return false;
+                }
+            }
+            return true;
+        } else if (tag == BLOG_TAG_REPEAT) {
+            quint64 ignored; // at the start of a file: the event it belongs to is at the end of the previous one
+            if (!readVarint(ignored)) {
+                error = "The log ends in the middle of a record";
+                return false;
+            }
+        } else {
+            error = QString("Unknown record tag %1, the log is corrupted").arg(static_cast<int>(tag));
+            return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,99 @@
+#ifndef TIMECAMPDESKTOP_BINARYLOG_H
+#define TIMECAMPDESKTOP_BINARYLOG_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Binary log ("TCBLOG01"), what LOGUTILS writes instead of text when binary logging is on:
+// after the 8-byte magic and the time the file was started (int64 ms since epoch, little endian),
+// the file is a stream of records, each starting with a tag byte:
+//  - BLOG_TAG_STRING: varint byte length, UTF-8 bytes; strings get ids 0, 1, 2... in order
+//  - BLOG_TAG_EVENT: level byte (QtMsgType), varint ms since the previous event (zigzag),
+//    varint category string id, varint format string id, varint argument count, the arguments as varints
+//  - BLOG_TAG_REPEAT: varint count; the previous event happened that many more times
+// A format string is the message with its numbers taken out ("%d"; a literal '%' is "%%"),
+// so messages that only differ in numbers share one string and an event is usually 5-10 bytes.
+// Every file has its own string table; LOGUTILS starts a new file when the table gets too big.
+
+#define BLOG_MAGIC "TCBLOG01"
+#define BLOG_MAGIC_SIZE 8
+#define BLOG_TAG_STRING 0x01
+#define BLOG_TAG_EVENT 0x02
+#define BLOG_TAG_REPEAT 0x03
+#define BLOG_MAX_ARGS 32
+
+struct BinaryLogEvent
+{
+    qint64 msSinceEpoch = 0;
+    QtMsgType type = QtDebugMsg;
+    QString category;
+    QString message;
+    quint64 repeated = 0; // how many more times it happened right after
+};
+
+namespace BinaryLog
+{
+    // "Synced 12 of 40%" -> "Synced %d of %d%%", {12, 40}; numbers with leading zeros stay in the text
+    void splitNumbers(const QString &message, QString &format, QVector<quint64> &args);
+    QString joinNumbers(const QString &format, const QVector<quint64> &args);
+    const char *levelName(QtMsgType type);
+}
+
+/**
+ * @brief Encodes log messages into BinaryLog records, appended to a caller's buffer
+ *
+ * Not thread-safe; LOGUTILS only uses it on its log thread.
+ */
+class BinaryLogEncoder
+{
+public:
+    // the file header; forgets all strings, they have to be defined again in the new file
+    QByteArray begin(qint64 msSinceEpoch);
+    void appendEvent(QByteArray &out, qint64 msSinceEpoch, QtMsgType type, const char *category, const QString &message);
+    void appendRepeat(QByteArray &out, quint64 count);
+    // time to start a new file, so a reader doesn't have to hold an ever growing string table
+    bool isFull() const;
+
+private:
+    QHash<QString, quint32> formatIds;
+    QHash<QByteArray, quint32> categoryIds;
+    quint32 stringCount = 0;
+    qint64 stringBytes = 0;
+    qint64 lastEventMs = 0;
+    QString format; // reused for every message
+    QVector<quint64> args;
+
+    quint32 defineString(QByteArray &out, const QByteArray &utf8);
+    static void appendVarint(QByteArray &out, quint64 value);
+};
+
+class BinaryLogReader
+{
+    Q_DISABLE_COPY(BinaryLogReader)
+
+public:
+    explicit BinaryLogReader(const QString &path);
+
+    static bool isBinaryLog(const QString &path);
+
+    bool isOpen() const;
+    qint64 startedAt() const;
+    bool readNext(BinaryLogEvent &event);
+    // empty unless the file ended in the middle of a record or had one that doesn't make sense
+    QString errorString() const;
+
+private:
+    QFile file;
+    QVector<QString> strings;
+    qint64 startMs = 0;
+    qint64 lastEventMs = 0;
+    QString error;
+
+    bool readVarint(quint64 &value);
+    bool readString(quint64 id, QString &string) const;
+};
+
+#endif //TIMECAMPDESKTOP_BINARYLOG_H
@@ -0,0 +1,205 @@
+#include "BrowserProfileRegistry.h"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QStandardPaths>
+
+bool BrowserProfileRegistry::Profile::isFirefox() const
+{
+    return browser == "firefox";
+}
+
+QString BrowserProfileRegistry::browserForProcess(const QString &processName)
+{
+    // process names as the OS reports them; on Linux they're cut to 15 characters
+    static const QHash<QString, QString> browsers = {
+        {"firefox", "firefox"}, {"firefox-bin", "firefox"}, {"firefox-esr", "firefox"},
+        {"chrome", "chrome"}, {"google-chrome", "chrome"},
+        {"chromium", "chromium"}, {"chromium-browse", "chromium"}, {"chromium-browser", "chromium"},
+        {"brave", "brave"}, {"brave-browser", "brave"},
+        {"msedge", "msedge"}, {"microsoft-edge", "msedge"},
+        {"vivaldi", "vivaldi"}, {"vivaldi-bin", "vivaldi"},
+    };
+    return browsers.value(processName.toLower());
+}
+
+QVector<BrowserProfileRegistry::Root> BrowserProfileRegistry::browserRoots()
+{
+    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::HomeLocation).first();
+#ifdef Q_OS_MACOS
+    QString appSupport = homeDir + "/Library/Application Support";
+    return {
+        {"firefox", appSupport + "/Firefox/Profiles"},
+        {"chrome", appSupport + "/Google/Chrome"},
+        {"chromium", appSupport + "/Chromium"},
+        {"brave", appSupport + "/BraveSoftware/Brave-Browser"},
+        {"msedge", appSupport + "/Microsoft Edge"},
+        {"vivaldi", appSupport + "/Vivaldi"},
+    };
+#else
+    QString configDir = homeDir + "/.config";
+    return {
+        {"firefox", homeDir + "/.mozilla/firefox"},
+        {"firefox", homeDir + "/snap/firefox/common/.mozilla/firefox"},
+        {"firefox", homeDir + "/.var/app/org.mozilla.firefox/.mozilla/firefox"},
+        {"chrome", configDir + "/google-chrome"},
+        {"chrome", configDir + "/google-chrome-beta"},
+        {"chrome", configDir + "/google-chrome-unstable"},
+        {"chromium", configDir + "/chromium"},
+        {"chromium", homeDir + "/snap/chromium/common/chromium"},
+        {"brave", configDir + "/BraveSoftware/Brave-Browser"},
+        {"msedge", configDir + "/microsoft-edge"},
+        {"msedge", configDir + "/microsoft-edge-beta"},
+        {"msedge", configDir + "/microsoft-edge-dev"},
+        {"vivaldi", configDir + "/vivaldi"},
+    };
+#endif
+}
+
+void BrowserProfileRegistry::addFirefoxProfiles(const Root &root, QVector<Profile> &found)
+{
+    // every profile, not just *.default - newer Firefox names them *.default-release, or whatever the user chose
+    QDir rootDir(root.path);
+    for (const QString &profileName : rootDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable)) {
+        Profile profile;
+        profile.browser = root.browser;
+        profile.directory = rootDir.absoluteFilePath(profileName);
+        profile.sessionCandidates = QStringList{
+            profile.directory + "/sessionstore-backups/recovery.jsonlz4",
+            profile.directory + "/sessionstore-backups/recovery.js",
+            profile.directory + "/sessionstore.js",
+        };
+        discoveryPaths << profile.directory; // sessionstore-backups appears on first run
+        found.append(profile);
+    }
+}
+
+void BrowserProfileRegistry::addChromiumProfiles(const Root &root, QVector<Profile> &found)
+{
+    QDir rootDir(root.path);
+    for (const QString &profileName : rootDir.entryList({"Default", "Profile *"}, QDir::Dirs | QDir::Readable)) {
+        Profile profile;
+        profile.browser = root.browser;
+        profile.directory = rootDir.absoluteFilePath(profileName);
+        profile.sessionCandidates << profile.directory + "/Current Session";
+
+        // newer versions keep the session in Sessions/Session_<timestamp>, starting a new file now and then
+        QDir sessionsDir(profile.directory + "/Sessions");
+        if (sessionsDir.exists()) {
+            QStringList sessionFiles = sessionsDir.entryList({"Session_*"}, QDir::Files, QDir::Name);
+            if (!sessionFiles.isEmpty()) {
+                profile.sessionCandidates << sessionsDir.absoluteFilePath(sessionFiles.last());
+            }
+            discoveryPaths << sessionsDir.absolutePath();
+        } else {
+            discoveryPaths << profile.directory;
+        }
+        found.append(profile);
+    }
+}
+
+void BrowserProfileRegistry::rescan()
+{
+    QVector<Profile> found;
+    discoveryPaths.clear();
+
+    for (const Root &root : browserRoots()) {
+        if (!QFileInfo(root.path).isDir()) {
+            continue;
+        }
+        discoveryPaths << root.path; // new profiles
+        if (root.browser == "firefox") {
+            addFirefoxProfiles(root, found);
+        } else {
+            addChromiumProfiles(root, found);
+        }
+    }
+
+    // keep what we know about profiles that are still there, so they're not reparsed for nothing
+    for (Profile &profile : found) {
+        for (const Profile &known : profiles) {
+            if (known.directory == profile.directory && known.sessionCandidates.contains(known.sessionPath)) {
+                profile.sessionPath = known.sessionPath;
+                profile.sessionSize = known.sessionSize;
+                profile.sessionModified = known.sessionModified;
+                break;
+            }
+        }
+    }
+
+    if (found.size() != profiles.size()) {
+        qDebug() << "[BrowserProfileRegistry] Found" << found.size() << "browser profiles";
+    }
+    profiles = found;
+    rank();
+}
+
+QStringList BrowserProfileRegistry::refreshSessionFiles()
+{
+    QStringList changedProfiles;
+    for (Profile &profile : profiles) {
+        QString newestPath;
+        qint64 newestSize = -1;
+        QDateTime newestModified;
+        for (const QString &candidate : profile.sessionCandidates) {
+            QFileInfo info(candidate);
+            if (info.exists() && (newestPath.isEmpty() || info.lastModified() > newestModified)) {
+                newestPath = candidate;
+                newestSize = info.size();
+                newestModified = info.lastModified();
+            }
+        }
+
+        if (newestPath != profile.sessionPath || newestSize != profile.sessionSize || newestModified != profile.sessionModified) {
+            profile.sessionPath = newestPath;
+            profile.sessionSize = newestSize;
+            profile.sessionModified = newestModified;
+            changedProfiles << profile.directory;
+        }
+    }
+
+    if (!changedProfiles.isEmpty()) {
+        rank();
+    }
+    return changedProfiles;
+}
+
+void BrowserProfileRegistry::rank()
+{
+    // the browser you're using writes its session every few seconds; profiles with no session go last
+    std::stable_sort(profiles.begin(), profiles.end(), [](const Profile &left, const Profile &right)
+    {
+        if (left.sessionModified.isValid() != right.sessionModified.isValid()) {
+            return left.sessionModified.isValid();
+        }
+        return left.sessionModified > right.sessionModified;
+    });
+}
+
+const QVector<BrowserProfileRegistry::Profile> &BrowserProfileRegistry::rankedProfiles() const
+{
+    return profiles;
+}
+
+bool BrowserProfileRegistry::isDiscoveryPath(const QString &path) const
+{
+    return discoveryPaths.contains(path);
+}
+
+QStringList BrowserProfileRegistry::watchPaths() const
+{
+    // directories catch session files being replaced, the files themselves catch appends
+    QStringList paths = discoveryPaths;
+    for (const Profile &profile : profiles) {
+        if (!profile.sessionPath.isEmpty()) {
+            QFileInfo sessionInfo(profile.sessionPath);
+            paths << profile.sessionPath << sessionInfo.absolutePath();
+        }
+    }
+    paths.removeDuplicates();
+    return paths;
+}
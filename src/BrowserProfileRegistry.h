@@ -0,0 +1,59 @@
+#ifndef TIMECAMPDESKTOP_BROWSERPROFILEREGISTRY_H
+#define TIMECAMPDESKTOP_BROWSERPROFILEREGISTRY_H
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief Every Firefox and Chromium-family profile on this machine, and where its live session is
+ *
+ * rescan() lists the browsers' profile directories - only needed at startup and when
+ * one of discoveryPaths() changes. refreshSessionFiles() just stats the known session files,
+ * and keeps the profiles ordered by their last session write, so the first profile
+ * of a browser is the one that's being used.
+ */
+class BrowserProfileRegistry
+{
+public:
+    struct Profile
+    {
+        QString browser; // "firefox", "chrome", "chromium", "brave", "msedge" or "vivaldi"
+        QString directory;
+        QStringList sessionCandidates;
+        QString sessionPath; // most recently written of the candidates
+        qint64 sessionSize = -1;
+        QDateTime sessionModified;
+
+        bool isFirefox() const;
+    };
+
+    // process name -> browser, or an empty string for anything that isn't a browser we can read
+    static QString browserForProcess(const QString &processName);
+
+    void rescan();
+    // returns directories of the profiles whose session file changed
+    QStringList refreshSessionFiles();
+
+    const QVector<Profile> &rankedProfiles() const;
+    bool isDiscoveryPath(const QString &path) const;
+    QStringList watchPaths() const;
+
+private:
+    struct Root
+    {
+        QString browser;
+        QString path;
+    };
+
+    QVector<Profile> profiles;
+    QStringList discoveryPaths;
+
+    static QVector<Root> browserRoots();
+    void addFirefoxProfiles(const Root &root, QVector<Profile> &found);
+    void addChromiumProfiles(const Root &root, QVector<Profile> &found);
+    void rank();
+};
+
+#endif //TIMECAMPDESKTOP_BROWSERPROFILEREGISTRY_H
@@ -0,0 +1,189 @@
+#include "BrowserSessionWatcher.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStringList>
+
+#include "FirefoxUtils.h"
+#include "Tracing.h"
+
+// browsers replace session files with a write + rename, which comes as a burst of events
+static const int REFRESH_DEBOUNCE_MS = 250;
+// safety net for browsers installed after we started - there's nothing to watch for them yet
+static const int RESCAN_INTERVAL_MS = 60 * 1000;
+
+BrowserSessionWatcher &BrowserSessionWatcher::instance()
+{
+    static BrowserSessionWatcher _instance;
+    return _instance;
+}
+
+BrowserSessionWatcher::BrowserSessionWatcher(QObject *parent)
+    : QObject(parent)
+{
+    watcherThread.setObjectName("BrowserSessionWatcher");
+    moveToThread(&watcherThread);
+    connect(&watcherThread, &QThread::started, this, &BrowserSessionWatcher::setup);
+    connect(&watcherThread, &QThread::finished, this, &BrowserSessionWatcher::teardown, Qt::DirectConnection);
+    watcherThread.start(QThread::LowPriority);
+}
+
+BrowserSessionWatcher::~BrowserSessionWatcher()
+{
+    watcherThread.quit();
+    watcherThread.wait();
+}
+
+void BrowserSessionWatcher::setup()
+{
+    // created here, so they belong to the watcher thread
+    fsWatcher = new QFileSystemWatcher(this);
+    connect(fsWatcher, &QFileSystemWatcher::fileChanged, this, &BrowserSessionWatcher::sessionPathChanged);
+    connect(fsWatcher, &QFileSystemWatcher::directoryChanged, this, &BrowserSessionWatcher::sessionPathChanged);
+
+    debounceTimer = new QTimer(this);
+    debounceTimer->setSingleShot(true);
+    debounceTimer->setInterval(REFRESH_DEBOUNCE_MS);
+    connect(debounceTimer, &QTimer::timeout, this, &BrowserSessionWatcher::refresh);
+
+    rescanTimer = new QTimer(this);
+    rescanTimer->setInterval(RESCAN_INTERVAL_MS);
+    connect(rescanTimer, &QTimer::timeout, this, &BrowserSessionWatcher::rescan);
+    rescanTimer->start();
+
+    refresh();
+}
+
+void BrowserSessionWatcher::teardown()
+{
+    // runs on the watcher thread, right before it ends
+    delete fsWatcher;
+    fsWatcher = nullptr;
+    delete debounceTimer;
+    debounceTimer = nullptr;
+    delete rescanTimer;
+    rescanTimer = nullptr;
+}
+
+void BrowserSessionWatcher::sessionPathChanged(const QString &path)
+{
+    if (registry.isDiscoveryPath(path)) {
+        rescanPending = true; // a profile, or a new session file, might have appeared
+    }
+    debounceTimer->start();
+}
+
+void BrowserSessionWatcher::rescan()
+{
+    rescanPending = true;
+    refresh();
+}
+
+void BrowserSessionWatcher::watchSessionPaths()
+{
+    QStringList watchedPaths = fsWatcher->files() + fsWatcher->directories();
+    QStringList newPaths;
+    for (const QString &path : registry.watchPaths()) {
+        if (!watchedPaths.contains(path) && QFileInfo::exists(path)) {
+            newPaths << path;
+        }
+    }
+    if (!newPaths.isEmpty()) {
+        fsWatcher->addPaths(newPaths);
+    }
+}
+
+void BrowserSessionWatcher::refresh()
+{
+    TRACE_SCOPE("BrowserSessionWatcher::refresh");
+    if (rescanPending) {
+        registry.rescan();
+        rescanPending = false;
+    }
+
+    QStringList changedProfiles = registry.refreshSessionFiles();
+    QSet<QString> knownProfiles;
+    for (const BrowserProfileRegistry::Profile &profile : registry.rankedProfiles()) {
+        knownProfiles.insert(profile.directory);
+        if (!changedProfiles.contains(profile.directory)) {
+            continue;
+        }
+
+        if (profile.isFirefox()) {
+            firefoxURLs.insert(profile.directory, profile.sessionPath.isEmpty()
+                                                  ? QString() : getCurrentURLFromFirefoxFile(profile.sessionPath));
+        } else {
+            ChromeSessionParser &session = chromiumSessions[profile.directory];
+            session.setPath(profile.sessionPath);
+            session.update();
+        }
+    }
+
+    // forget profiles that were removed
+    bool profilesRemoved = false;
+    for (auto it = firefoxURLs.begin(); it != firefoxURLs.end();) {
+        if (knownProfiles.contains(it.key())) {
+            ++it;
+        } else {
+            it = firefoxURLs.erase(it);
+            profilesRemoved = true;
+        }
+    }
+    for (auto it = chromiumSessions.begin(); it != chromiumSessions.end();) {
+        if (knownProfiles.contains(it.key())) {
+            ++it;
+        } else {
+            it = chromiumSessions.erase(it);
+            profilesRemoved = true;
+        }
+    }
+
+    if (!changedProfiles.isEmpty() || profilesRemoved) {
+        publish();
+    }
+    watchSessionPaths();
+}
+
+void BrowserSessionWatcher::publish()
+{
+    QString activeFirefoxURL;
+    QVector<ChromiumTitles> titles;
+    for (const BrowserProfileRegistry::Profile &profile : registry.rankedProfiles()) {
+        if (profile.isFirefox()) {
+            if (activeFirefoxURL.isEmpty()) {
+                activeFirefoxURL = firefoxURLs.value(profile.directory);
+            }
+        } else if (chromiumSessions.contains(profile.directory)) {
+            titles.append({profile.browser, chromiumSessions[profile.directory].titleIndex()});
+        }
+    }
+
+    QMutexLocker locker(&dataMutex);
+    firefoxActiveURL = activeFirefoxURL;
+    chromiumTitles = titles;
+}
+
+QString BrowserSessionWatcher::firefoxURL() const
+{
+    QMutexLocker locker(&dataMutex);
+    return firefoxActiveURL;
+}
+
+QString BrowserSessionWatcher::chromiumURL(const QString &browser, QString windowTitle) const
+{
+    TRACE_SCOPE("BrowserSessionWatcher::chromiumURL");
+    QString pageTitle = chromeWindowTitleToPageTitle(windowTitle);
+    QMutexLocker locker(&dataMutex);
+    for (const ChromiumTitles &profileTitles : chromiumTitles) {
+        if (profileTitles.browser != browser) {
+            continue;
+        }
+        auto found = profileTitles.titleIndex.constFind(pageTitle);
+        if (found != profileTitles.titleIndex.constEnd()) {
+            return found.value();
+        }
+    }
+    return QString();
+}
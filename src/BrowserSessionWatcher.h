@@ -0,0 +1,72 @@
+#ifndef TIMECAMPDESKTOP_BROWSERSESSIONWATCHER_H
+#define TIMECAMPDESKTOP_BROWSERSESSIONWATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+#include "BrowserProfileRegistry.h"
+#include "ChromeUtils.h"
+
+/**
+ * @brief Keeps the browsers' session data in memory, so URL lookups don't touch the disk
+ *
+ * Runs on its own thread and watches the session files of every profile BrowserProfileRegistry finds
+ * (inotify on Linux). A file is reparsed only when its mtime or size changed since the last parse
+ * (Chrome's session only from where we stopped last time); lookups just read the cached result
+ * of the most recently written profile.
+ */
+class BrowserSessionWatcher : public QObject
+{
+Q_OBJECT
+    Q_DISABLE_COPY(BrowserSessionWatcher)
+
+public:
+    static BrowserSessionWatcher &instance();
+    ~BrowserSessionWatcher() override;
+
+    QString firefoxURL() const;
+    // browser as in BrowserProfileRegistry::browserForProcess()
+    QString chromiumURL(const QString &browser, QString windowTitle) const;
+
+private:
+    explicit BrowserSessionWatcher(QObject *parent = nullptr);
+
+    struct ChromiumTitles
+    {
+        QString browser;
+        QHash<QString, QString> titleIndex;
+    };
+
+    QThread watcherThread;
+    QFileSystemWatcher *fsWatcher = nullptr;
+    QTimer *debounceTimer = nullptr;
+    QTimer *rescanTimer = nullptr;
+
+    // only used on the watcher thread
+    BrowserProfileRegistry registry;
+    bool rescanPending = true;
+    QHash<QString, QString> firefoxURLs; // profile directory -> active URL
+    QHash<QString, ChromeSessionParser> chromiumSessions; // profile directory -> its session
+
+    mutable QMutex dataMutex; // guards everything below
+    QString firefoxActiveURL;
+    QVector<ChromiumTitles> chromiumTitles; // most recently used profile first
+
+    void publish();
+    void watchSessionPaths();
+
+private slots:
+    void setup();
+    void teardown();
+    void sessionPathChanged(const QString &path);
+    void rescan();
+    void refresh();
+};
+
+#endif //TIMECAMPDESKTOP_BROWSERSESSIONWATCHER_H
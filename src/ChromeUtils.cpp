@@ -8,122 +8,370 @@
 
 #include "ChromeUtils.h"
 
-#include <QStandardPaths>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <utility>
+
+#include <QFile>
 #include <QFileInfo>
+#include <QStringList>
 #include <QDebug>
-#include <QTextCodec>
 
+// Chrome's components/sessions/core/session_service_commands.cc
+const quint8 kCommandSetTabWindow = 0;
+const quint8 kCommandSetTabIndexInWindow = 2;
+const quint8 kCommandTabNavigationPathPrunedFromBack = 5;
+const quint8 kCommandUpdateTabNavigation = 6;
+const quint8 kCommandSetSelectedNavigationIndex = 7;
+const quint8 kCommandSetSelectedTabInIndex = 8;
+const quint8 kCommandTabClosed = 16;
+const quint8 kCommandWindowClosed = 17;
+const quint8 kCommandSetActiveWindow = 20;
 
-QString getChromeSessionFilePath() {
-#ifdef Q_OS_LINUX
-    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::HomeLocation).first();
-#elif defined(Q_OS_WIN)
-    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::HomeLocation).first();
-#else
-    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation).first();
-#endif
+const char snss_magic[] = {'S', 'N', 'S', 'S'};
+const int snss_header_size = 8; /* magic + int32 version */
 
-    QString currentSessionPath = homeDir + "/.config/google-chrome/Default/Current Session";
+QString chromeWindowTitleToPageTitle(QString windowTitle) {
+    static const QStringList browserSuffixes = {
+        " - Google Chrome", " - Chromium", " - Brave", " - Vivaldi",
+        QString(" - Microsoft") + QChar(0x200B) + " Edge", " - Microsoft Edge" // Edge puts a zero-width space in its name
+    };
 
-    return currentSessionPath;
+    for (const QString &suffix : browserSuffixes) {
+        if (windowTitle.endsWith(suffix)) {
+            windowTitle.chop(suffix.size());
+            break;
+        }
+    }
+    return windowTitle.trimmed();
 }
 
-QString getChromeTabsFilePath() {
-#ifdef Q_OS_LINUX
-    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::HomeLocation).first();
-#elif defined(Q_OS_WIN)
-    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::HomeLocation).first();
-#else
-    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation).first();
-#endif
+namespace
+{
+    // reads fields of a base::Pickle: uint32 payload size, then 4-byte aligned fields
+    class PickleReader
+    {
+    public:
+        PickleReader(const char *data, int size)
+            : position(data), end(data + size) {}
 
-    QString currentTabsPath = homeDir + "/.config/google-chrome/Default/Current Tabs";
+        bool skipHeader()
+        {
+            return skip(4);
+        }
 
-    return currentTabsPath;
-}
+        bool readInt32(qint32 &value)
+        {
+            if (end - position < 4) {
+                return false;
+            }
+            memcpy(&value, position, 4); // SNSS is little endian, like every platform Chrome runs on
+            position += 4;
+            return true;
+        }
+
+        bool readString(QString &value)
+        {
+            qint32 length;
+            if (!readInt32(length) || length < 0 || end - position < length) {
+                return false;
+            }
+            value = QString::fromUtf8(position, length);
+            return skip(align(length));
+        }
 
-QString getCurrentURLFromChromeConfig(QByteArray &data, QString &windowTitle) {
-
-    // try to read data the best way possible
-    QString snss = QTextCodec::codecForName("UTF-16")->toUnicode(data);
-
-    // remove some confusing strings
-    snss = snss.remove("\r\n");
-    snss = snss.remove('\r');
-    snss = snss.remove('\n');
-
-    QString urlTitle = windowTitle;
-    urlTitle = urlTitle.replace("- Google Chrome", ""); // cut browser name
-    urlTitle = urlTitle.trimmed();
-
-    // super extensive searching, removing some troublesome characters
-    // might still not be enough :(
-    int pos;
-    pos = snss.indexOf(urlTitle);
-    if (pos == -1) {
-        snss = snss.remove('|');
-        urlTitle = urlTitle.remove('|');
-        urlTitle = urlTitle.trimmed();
-        pos = snss.indexOf(urlTitle);
-        if (pos == -1) {
-            snss = snss.remove("-");
-            snss = snss.remove("−");
-            snss = snss.remove("–");
-            snss = snss.remove("—");
-            snss = snss.remove("―");
-
-            urlTitle = urlTitle.remove("-");
-            urlTitle = urlTitle.remove("−");
-            urlTitle = urlTitle.remove("–");
-            urlTitle = urlTitle.remove("—");
-            urlTitle = urlTitle.remove("―");
-            urlTitle = urlTitle.trimmed();
-            pos = snss.indexOf(urlTitle);
-            if (pos == -1) {
-                qDebug("[ChromeURL] Failed to find url for given title");
-                return "";
+        bool readString16(QString &value)
+        {
+            qint32 length;
+            if (!readInt32(length) || length < 0 || (end - position) / 2 < length) {
+                return false;
             }
+            value.resize(length);
+            memcpy(value.data(), position, static_cast<size_t>(length) * 2);
+            return skip(align(length * 2));
         }
+
+    private:
+        const char *position;
+        const char *end;
+
+        static int align(int size)
+        {
+            return (size + 3) & ~3;
+        }
+
+        bool skip(int size)
+        {
+            if (end - position < size) {
+                position = end;
+                return false;
+            }
+            position += size;
+            return true;
+        }
+    };
+
+    // plain structs the commands are written as
+    bool readIdPair(const char *payload, int payloadSize, qint32 &first, qint32 &second)
+    {
+        if (payloadSize < 8) {
+            return false;
+        }
+        memcpy(&first, payload, 4);
+        memcpy(&second, payload + 4, 4);
+        return true;
     }
 
-    QStringRef truncatedRef = snss.midRef(pos);
-    int urlPos = truncatedRef.indexOf("http");
+    bool readId(const char *payload, int payloadSize, qint32 &id)
+    {
+        if (payloadSize < 4) {
+            return false;
+        }
+        memcpy(&id, payload, 4);
+        return true;
+    }
 
-    if (urlPos == -1) {
-        qDebug("[ChromeURL] Failed to find 'http' after website name");
-        return "";
+    // changes when the file is replaced, which Chrome does when it rewrites the session
+    quint64 fileIdentityOf(const QString &path)
+    {
+        struct stat attributes;
+        if (stat(QFile::encodeName(path).constData(), &attributes) != 0) {
+            return 0;
+        }
+        return (static_cast<quint64>(attributes.st_dev) << 32) ^ static_cast<quint64>(attributes.st_ino);
     }
+}
 
-    // convert to latin1 - it strips most of weird unicode chars, leaves proper URI stuff
-    QString truncatedStr = truncatedRef.mid(urlPos).toLatin1();
+ChromeSessionParser::ChromeSessionParser(QString path)
+    : path(std::move(path))
+{
+}
+
+void ChromeSessionParser::setPath(const QString &newPath)
+{
+    if (newPath != path) {
+        path = newPath;
+        reset();
+    }
+}
 
-    return truncatedStr.trimmed();
+void ChromeSessionParser::reset()
+{
+    parsedOffset = 0;
+    fileIdentity = 0;
+    tabs.clear();
+    selectedTabIndexInWindow.clear();
+    activeWindowId = -1;
+    pageTitleIndex.clear();
 }
 
-QByteArray readChromeFile(const QString &filename) {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return "";
+bool ChromeSessionParser::update()
+{
+    QFile file(path);
+    if (path.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        bool hadState = !tabs.isEmpty();
+        reset();
+        return hadState;
+    }
+
+    quint64 identity = fileIdentityOf(path);
+    qint64 fileSize = file.size();
+    bool changed = false;
+    if (identity != fileIdentity || fileSize < parsedOffset) {
+        // rewritten from scratch - start over
+        changed = !tabs.isEmpty();
+        reset();
+        fileIdentity = identity;
+    }
+
+    if (parsedOffset == 0) {
+        QByteArray header = file.read(snss_header_size);
+        if (header.size() < snss_header_size || memcmp(header.constData(), snss_magic, sizeof snss_magic) != 0) {
+            qDebug("[ChromeURL] Not a SNSS session file");
+            return changed;
+        }
+        parsedOffset = snss_header_size;
+    }
+
+    if (fileSize == parsedOffset || !file.seek(parsedOffset)) {
+        return changed;
+    }
+
+    QByteArray appended = file.read(fileSize - parsedOffset);
+    const char *data = appended.constData();
+    int available = appended.size();
+    int offset = 0;
+    while (available - offset >= 2) {
+        int commandSize = static_cast<quint8>(data[offset]) | (static_cast<quint8>(data[offset + 1]) << 8);
+        if (available - offset - 2 < commandSize) {
+            break; // Chrome is still writing this one, we'll get it on the next update
+        }
+        if (commandSize > 0) {
+            applyCommand(static_cast<quint8>(data[offset + 2]), data + offset + 3, commandSize - 1);
+            changed = true;
+        }
+        offset += 2 + commandSize;
     }
+    parsedOffset += offset;
 
-    QByteArray blob = file.readAll();
-    return blob;
+    if (changed) {
+        rebuildIndex();
+    }
+    return changed;
 }
 
-QString getCurrentURLFromChrome(QString windowTitle) {
-    QString chromeSessionFilePath = getChromeSessionFilePath();
-    QByteArray sessionContent = readChromeFile(chromeSessionFilePath);
-    QString activeURL = "";
-    if (!sessionContent.isEmpty()) {
-        activeURL = getCurrentURLFromChromeConfig(sessionContent, windowTitle);
+void ChromeSessionParser::applyCommand(quint8 id, const char *payload, int payloadSize)
+{
+    qint32 first;
+    qint32 second;
+
+    switch (id) {
+        case kCommandSetTabWindow:
+            if (readIdPair(payload, payloadSize, first, second)) {
+                tabs[second].windowId = first;
+            }
+            break;
+
+        case kCommandSetTabIndexInWindow:
+            if (readIdPair(payload, payloadSize, first, second)) {
+                tabs[first].indexInWindow = second;
+            }
+            break;
+
+        case kCommandTabNavigationPathPrunedFromBack:
+            if (readIdPair(payload, payloadSize, first, second) && tabs.contains(first)) {
+                QMap<qint32, Navigation> &navigations = tabs[first].navigations;
+                navigations.erase(navigations.lowerBound(second), navigations.end());
+            }
+            break;
+
+        case kCommandUpdateTabNavigation: {
+            PickleReader reader(payload, payloadSize);
+            qint32 tabId;
+            qint32 index;
+            Navigation navigation;
+            if (reader.skipHeader() && reader.readInt32(tabId) && reader.readInt32(index)
+                && reader.readString(navigation.url)) {
+                reader.readString16(navigation.title); // may be cut short in older files; the URL is what matters
+                Tab &tab = tabs[tabId];
+                tab.navigations.insert(index, navigation);
+                tab.lastUpdatedNavigation = index;
+            }
+            break;
+        }
+
+        case kCommandSetSelectedNavigationIndex:
+            if (readIdPair(payload, payloadSize, first, second)) {
+                tabs[first].selectedNavigation = second;
+            }
+            break;
+
+        case kCommandSetSelectedTabInIndex:
+            if (readIdPair(payload, payloadSize, first, second)) {
+                selectedTabIndexInWindow.insert(first, second);
+            }
+            break;
+
+        case kCommandTabClosed:
+            if (readId(payload, payloadSize, first)) {
+                tabs.remove(first);
+            }
+            break;
+
+        case kCommandWindowClosed:
+            if (readId(payload, payloadSize, first)) {
+                selectedTabIndexInWindow.remove(first);
+                for (auto it = tabs.begin(); it != tabs.end();) {
+                    if (it->windowId == first) {
+                        it = tabs.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+            break;
+
+        case kCommandSetActiveWindow:
+            if (readId(payload, payloadSize, first)) {
+                activeWindowId = first;
+            }
+            break;
+
+        default:
+            break; // bounds, pinning, user agents... don't matter for the URL
+    }
+}
+
+const ChromeSessionParser::Navigation *ChromeSessionParser::currentNavigation(const Tab &tab) const
+{
+    auto selected = tab.navigations.constFind(tab.selectedNavigation);
+    if (selected != tab.navigations.constEnd()) {
+        return &selected.value();
+    }
+    auto lastUpdated = tab.navigations.constFind(tab.lastUpdatedNavigation);
+    if (lastUpdated != tab.navigations.constEnd()) {
+        return &lastUpdated.value();
+    }
+    return nullptr;
+}
+
+const ChromeSessionParser::Tab *ChromeSessionParser::selectedTabOf(qint32 windowId) const
+{
+    auto selectedIndex = selectedTabIndexInWindow.constFind(windowId);
+    if (selectedIndex == selectedTabIndexInWindow.constEnd()) {
+        return nullptr;
+    }
+    for (const Tab &tab : tabs) {
+        if (tab.windowId == windowId && tab.indexInWindow == selectedIndex.value()) {
+            return &tab;
+        }
+    }
+    return nullptr;
+}
+
+void ChromeSessionParser::rebuildIndex()
+{
+    // cost depends on the number of open tabs, not on the size of the file
+    pageTitleIndex.clear();
+    QList<const Tab *> selectedTabs;
+    for (auto it = selectedTabIndexInWindow.constBegin(); it != selectedTabIndexInWindow.constEnd(); ++it) {
+        if (const Tab *tab = selectedTabOf(it.key())) {
+            selectedTabs.append(tab);
+        }
+    }
+    if (const Tab *activeTab = selectedTabOf(activeWindowId)) {
+        selectedTabs.append(activeTab);
+    }
+
+    // same titles in several tabs: later inserts win, so background tabs go first
+    for (const Tab &tab : qAsConst(tabs)) {
+        const Navigation *navigation = currentNavigation(tab);
+        if (navigation != nullptr && !navigation->title.isEmpty() && !selectedTabs.contains(&tab)) {
+            pageTitleIndex.insert(navigation->title.trimmed(), navigation->url);
+        }
     }
-    if (activeURL.isEmpty()) {
-        QString chromeTabsFilePath = getChromeTabsFilePath();
-        QByteArray tabsContent = readChromeFile(chromeTabsFilePath);
-        activeURL = getCurrentURLFromChromeConfig(tabsContent, windowTitle);
+    for (const Tab *tab : selectedTabs) {
+        const Navigation *navigation = currentNavigation(*tab);
+        if (navigation != nullptr && !navigation->title.isEmpty()) {
+            pageTitleIndex.insert(navigation->title.trimmed(), navigation->url);
+        }
     }
+}
 
-    qDebug() << "[ChromeUtils::getCurrentURLFromChrome] Chrome active URL: " << activeURL;
+QHash<QString, QString> ChromeSessionParser::titleIndex() const
+{
+    return pageTitleIndex;
+}
+
+QString ChromeSessionParser::urlForTitle(const QString &pageTitle) const
+{
+    return pageTitleIndex.value(pageTitle);
+}
 
-    return activeURL;
+QString ChromeSessionParser::activeTabURL() const
+{
+    const Tab *activeTab = selectedTabOf(activeWindowId);
+    const Navigation *navigation = activeTab != nullptr ? currentNavigation(*activeTab) : nullptr;
+    return navigation != nullptr ? navigation->url : QString();
 }
@@ -1,12 +1,61 @@
 #pragma once
 
+#include <QHash>
+#include <QMap>
 #include <QString>
 
-QString getChromeSessionFilePath();
-QString getChromeTabsFilePath();
-QString getCurrentURLFromChromeConfig(QByteArray &data, QString &windowTitle);
+QString chromeWindowTitleToPageTitle(QString windowTitle);
 
-QByteArray readChromeFile(const QString &filename);
-QString getCurrentURLFromChrome(QString windowTitle);
+/**
+ * @brief Follows a Chromium-family session file, "Current Session" or Sessions/Session_* (SNSS command log)
+ *
+ * The file is a "SNSS" header followed by commands: uint16 size, uint8 command id, payload.
+ * Chrome only appends to it (and rewrites it from scratch now and then), so update() reads
+ * just the bytes appended since the last call, and replays them onto the tab/window state.
+ * After every update the page titles of all open tabs are indexed, so lookups are a hash lookup.
+ */
+class ChromeSessionParser
+{
+public:
+    explicit ChromeSessionParser(QString path = QString());
 
+    void setPath(const QString &newPath);
+    // returns true when anything changed
+    bool update();
 
+    // title -> URL of the page it belongs to, selected tabs win over background ones
+    QHash<QString, QString> titleIndex() const;
+    QString urlForTitle(const QString &pageTitle) const;
+    QString activeTabURL() const;
+
+private:
+    struct Navigation
+    {
+        QString url;
+        QString title;
+    };
+
+    struct Tab
+    {
+        qint32 windowId = -1;
+        qint32 indexInWindow = -1;
+        qint32 selectedNavigation = -1;
+        qint32 lastUpdatedNavigation = -1;
+        QMap<qint32, Navigation> navigations;
+    };
+
+    QString path;
+    qint64 parsedOffset = 0;
+    quint64 fileIdentity = 0;
+
+    QHash<qint32, Tab> tabs;
+    QHash<qint32, qint32> selectedTabIndexInWindow; // window id -> index of its selected tab
+    qint32 activeWindowId = -1;
+    QHash<QString, QString> pageTitleIndex;
+
+    void reset();
+    void applyCommand(quint8 id, const char *payload, int payloadSize);
+    void rebuildIndex();
+    const Navigation *currentNavigation(const Tab &tab) const;
+    const Tab *selectedTabOf(qint32 windowId) const;
+};
@@ -1,7 +1,12 @@
 #include "Comms.h"
 #include "Settings.h"
+#include "SettingsSnapshot.h"
 
 #include "DbManager.h"
+#include "TaskIngest.h"
+#include "LogCategories.h"
+#include "Metrics.h"
+#include "Tracing.h"
 
 #include <QDateTime>
 #include <QNetworkAccessManager>
@@ -13,6 +18,7 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QtConcurrent/QtConcurrentRun>
 
 Comms &Comms::instance()
 {
@@ -25,6 +31,8 @@ Comms::Comms(QObject *parent) : QObject(parent)
     qnam.setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
     // connect the callback function
     QObject::connect(&qnam, &QNetworkAccessManager::finished, this, &Comms::genericReply);
+    // parsed tasks are published on this thread, when they're ready
+    QObject::connect(&tasksWatcher, &QFutureWatcherBase::finished, this, &Comms::publishParsedTasks);
 }
 
 QUrlQuery Comms::getApiParams()
@@ -71,6 +79,7 @@ void Comms::timedUpdates()
 
 void Comms::tryToSendAppData()
 {
+    TRACE_SCOPE("Comms::tryToSendAppData");
     QVector<AppData> appList;
     try {
         appList = DbManager::instance().getAppsSinceLastSync(lastSync); // get apps since last sync; SQL queries for LIMIT = MAX_ACTIVITIES_BATCH_SIZE
@@ -79,6 +88,13 @@ void Comms::tryToSendAppData()
         return;
     }
 
+    static MetricGauge &unsynced = Metrics::instance().gauge("db_unsynced_activities", "Activities in the local DB not sent yet");
+    // a batch that isn't full is all there is; only a full one needs the rest counted
+    int backlog = appList.length() < MAX_ACTIVITIES_BATCH_SIZE ? appList.length() : DbManager::instance().countAppsSinceLastSync(lastSync);
+    if (backlog >= 0) {
+        unsynced.set(backlog);
+    }
+
     qDebug() << "[AppList] length: " << appList.length();
     // send only if there is anything to send (0 is if "computer activities" are disabled, 1 is sometimes only with "IDLE" - don't send that)
     if (appList.length() > 1 || (appList.length() == 1 && appList.first().getAppName() != "IDLE")) {
@@ -100,6 +116,7 @@ void Comms::clearLastApp()
 
 void Comms::saveApp(AppData *app)
 {
+    TRACE_SCOPE("Comms::saveApp");
     if (lastApp == nullptr) {
         qDebug() << "[FIRST APP DETECTED]";
         qint64 now = QDateTime::currentMSecsSinceEpoch();
@@ -134,18 +151,18 @@ void Comms::saveApp(AppData *app)
                 return;
             }
 
-            qInfo("[DBSAVE] %llds - %s | %s\nADD_INFO: %s \n",
+            qCInfo(lcActivity, "[DBSAVE] %llds - %s | %s\nADD_INFO: %s \n",
                    (lastApp->getEnd() - lastApp->getStart()) / 1000,
-                   lastApp->getAppName().toLatin1().constData(),
-                   lastApp->getWindowName().toLatin1().constData(),
-                   lastApp->getAdditionalInfo().toLatin1().constData()
+                   qUtf8Printable(lastApp->getAppName()),
+                   qUtf8Printable(lastApp->getWindowName()),
+                   qUtf8Printable(lastApp->getAdditionalInfo())
             );
 
             app->setStart(now); // saved OK, so new App starts "NOW"
         } else {
-            qWarning("[DBSAVE] Activity too short (%lldms) - %s",
+            qCDebug(lcActivity, "[DBSAVE] Activity too short (%lldms) - %s",
                   lastApp->getEnd() - lastApp->getStart(),
-                  lastApp->getAppName().toLatin1().constData()
+                  qUtf8Printable(lastApp->getAppName())
             );
 
             app->setStart(lastApp->getStart()); // not saved, so new App starts when the old one has started
@@ -153,8 +170,8 @@ void Comms::saveApp(AppData *app)
 
         // some weird case:
         if(lastApp->getStart() > lastApp->getEnd()) { // it started later than it finished?!
-            qInfo("[DBSAVE] Activity (%s) broken: from %lld, to %lld",
-                  lastApp->getAppName().toLatin1().constData(),
+            qCInfo(lcActivity, "[DBSAVE] Activity (%s) broken: from %lld, to %lld",
+                  qUtf8Printable(lastApp->getAppName()),
                   lastApp->getStart(),
                   lastApp->getEnd()
             );
@@ -179,8 +196,9 @@ bool Comms::updateApiKeyFromSettings()
 
 void Comms::sendAppData(QVector<AppData> *appList)
 {
-    bool canSendActivityInfo = !settings.value(QString("SETT_WEB_") + QString("dontCollectComputerActivity")).toBool();
-    bool canSendWindowTitles = settings.value(QString("SETT_WEB_") + QString("collectWindowTitles")).toBool();
+    const SettingsSnapshot &currentSettings = SettingsService::instance().current();
+    bool canSendActivityInfo = currentSettings.collectComputerActivity;
+    bool canSendWindowTitles = currentSettings.collectWindowTitles;
 
     QUrlQuery params = getApiParams();
 
@@ -248,7 +266,7 @@ void Comms::sendAppData(QVector<AppData> *appList)
 void Comms::appDataReply(QByteArray buffer)
 {
     buffer.truncate(MAX_LOG_TEXT_LENGTH);
-    qDebug() << "AppData Response: " << buffer;
+    qCDebug(lcNetwork) << "AppData Response: " << buffer;
     if (buffer == "") {
         qDebug() << "update last sync to whenever we sent the data";
         settings.setValue(SETT_LAST_SYNC, lastSync); // update last sync to our internal variable (to the last app in the last set)
@@ -290,7 +308,7 @@ void Comms::userInfoReply(QByteArray buffer)
     QJsonDocument itemDoc = QJsonDocument::fromJson(buffer);
 
     buffer.truncate(MAX_LOG_TEXT_LENGTH);
-    qDebug() << "UserInfo Response: " << buffer;
+    qCDebug(lcNetwork) << "UserInfo Response: " << buffer;
 
     QJsonObject rootObject = itemDoc.object();
     user_id = rootObject.value("user_id").toString().toInt();
@@ -360,23 +378,24 @@ void Comms::settingsReply(QByteArray buffer)
 {
     QJsonDocument itemDoc = QJsonDocument::fromJson(buffer);
     buffer.truncate(MAX_LOG_TEXT_LENGTH);
-    qDebug() << "Settings Response: " << buffer;
+    qCDebug(lcNetwork) << "Settings Response: " << buffer;
 
     QJsonArray rootArray = itemDoc.array();
     for (QJsonValueRef val: rootArray) {
         QJsonObject obj = val.toObject();
 //        qDebug() << obj.value("name").toString() << ": " << obj.value("value").toString();
-        settings.setValue(QString("SETT_WEB_") + obj.value("name").toString(), obj.value("value").toString()); // save web settings to our settingsstore
+        settings.setValue(QString(SETT_WEB_PREFIX) + obj.value("name").toString(), obj.value("value").toString()); // save web settings to our settingsstore
     }
     settings.sync();
+    SettingsService::instance().reload(); // hot paths read the snapshot, not QSettings
 
-    qDebug() << "SETT idletime: " << settings.value(QString("SETT_WEB_") + QString("idletime")).toInt();
-    qDebug() << "SETT logoffline: " << settings.value(QString("SETT_WEB_") + QString("logoffline")).toBool();
-    qDebug() << "SETT logofflinemin: " << settings.value(QString("SETT_WEB_") + QString("logofflinemin")).toInt();
+    qDebug() << "SETT idletime: " << settings.value(SETT_WEB_IDLE_TIME).toInt();
+    qDebug() << "SETT logoffline: " << settings.value(SETT_WEB_LOG_OFFLINE).toBool();
+    qDebug() << "SETT logofflinemin: " << settings.value(SETT_WEB_LOG_OFFLINE_MIN).toInt();
     qDebug() << "SETT dontCollectComputerActivity: "
-            << settings.value(QString("SETT_WEB_") + QString("dontCollectComputerActivity")).toBool();
+            << settings.value(SETT_WEB_DONT_COLLECT_COMPUTER_ACTIVITY).toBool();
     qDebug() << "SETT collectWindowTitles: "
-            << settings.value(QString("SETT_WEB_") + QString("collectWindowTitles")).toBool();
+            << settings.value(SETT_WEB_COLLECT_WINDOW_TITLES).toBool();
 }
 
 void Comms::getTasks()
@@ -388,38 +407,43 @@ void Comms::getTasks()
 
 void Comms::tasksReply(QByteArray buffer)
 {
-    QJsonDocument itemDoc = QJsonDocument::fromJson(buffer);
+    qCDebug(lcNetwork) << "Tasks Response: " << buffer.left(MAX_LOG_TEXT_LENGTH);
 
-    buffer.truncate(MAX_LOG_TEXT_LENGTH);
-    qDebug() << "Tasks Response: " << buffer;
-
-    DbManager::instance().clearTaskList();
+    // big accounts have tens of thousands of tasks, parsing them here would freeze the tray and widget;
+    // a newer reply replaces one still being parsed
+    tasksPending = true;
+    tasksWatcher.setFuture(QtConcurrent::run(&TaskIngest::parseTasksReply, buffer));
+}
 
-    QJsonObject rootObject = itemDoc.object();
-    for (auto oneTaskJSON: rootObject) {
-        QJsonObject oneTask = oneTaskJSON.toObject();
-        qint64 task_id = oneTask.value("task_id").toString().toLongLong();
-        QString name = oneTask.value("name").toString();
-        QString tags = oneTask.value("tags").toString();
-        Task* impTask = new Task(task_id);
-        impTask->setName(name);
-        impTask->setKeywords(tags);
-        DbManager::instance().addToTaskList(impTask);
+void Comms::publishParsedTasks()
+{
+    if (!tasksPending) {
+        return;
     }
+    tasksPending = false;
+    DbManager::instance().publishTaskCatalog(tasksWatcher.result());
+}
+
+void Comms::waitForTasks()
+{
+    tasksWatcher.waitForFinished();
+    publishParsedTasks();
 }
 
 void Comms::genericReply(QNetworkReply *reply)
 {
     QByteArray buffer = reply->readAll();
     if (reply->error() != QNetworkReply::NoError) {
+        static MetricCounter &failedRequests = Metrics::instance().counter("comms_request_errors_total", "API requests that failed");
+        failedRequests.add();
         qWarning() << "Network error: " << reply->errorString();
         qWarning() << "URL: " << reply->url();
         qWarning() << "TYPE: " << reply->operation();
         qWarning() << "Response: " << buffer;
         return;
     } else {
-        qDebug() << "Network success";
-        qDebug() << "Data: " << buffer;
+        qCDebug(lcNetwork) << "Network success";
+        qCDebug(lcNetwork) << "Data: " << buffer.left(MAX_LOG_TEXT_LENGTH);
     }
 
     QString stringUrl = reply->url().toString();
@@ -434,10 +458,7 @@ void Comms::genericReply(QNetworkReply *reply)
 
 void Comms::netRequest(QNetworkRequest request, QNetworkAccessManager::Operation netOp, QByteArray data) // default params in Comms.h
 {
-    // make a copy of the request URL for the logger
-    QString requestUrl = request.url().toString();
-    requestUrl.truncate(MAX_LOG_TEXT_LENGTH);
-
+    TRACE_SCOPE("Comms::netRequest"); // the nested event loop included, so whatever it ran shows up inside
     // follow redirects
     request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
 
@@ -445,18 +466,22 @@ void Comms::netRequest(QNetworkRequest request, QNetworkAccessManager::Operation
     request.setRawHeader("User-Agent", CONN_USER_AGENT);
     request.setRawHeader(CONN_CUSTOM_HEADER_NAME, CONN_CUSTOM_HEADER_VALUE);
 
+    static MetricCounter &requests = Metrics::instance().counter("comms_requests_total", "API requests made");
+    static MetricHistogram &roundTrip = Metrics::instance().histogram("comms_round_trip_us", "API request to its reply being handled");
+    requests.add();
+    MetricTimer timer(roundTrip);
+
     // create a reply object
     QNetworkReply *reply = nullptr;
 
     // make the actual request
     if(netOp == QNetworkAccessManager::GetOperation) {
-        qDebug() << "[GET] URL: " << requestUrl;
+        qCDebug(lcNetwork) << "[GET] URL: " << request.url().toString().left(MAX_LOG_TEXT_LENGTH);
         reply = qnam.get(request);
     }else if(netOp == QNetworkAccessManager::PostOperation) {
-        qDebug() << "[POST] URL: " << requestUrl;
+        qCDebug(lcNetwork) << "[POST] URL: " << request.url().toString().left(MAX_LOG_TEXT_LENGTH);
+        qCDebug(lcNetwork) << "[POST] Data: " << data.left(MAX_LOG_TEXT_LENGTH);
         reply = qnam.post(request, data);
-        data.truncate(MAX_LOG_TEXT_LENGTH);
-        qDebug() << "[POST] Data: " << data;
     }
 
     // if we got a reply, make sure it's finished; then queue it for deletion
@@ -1,6 +1,7 @@
 #ifndef COMMS_H
 #define COMMS_H
 
+#include <QFutureWatcher>
 #include <QObject>
 #include <QSettings>
 #include <QNetworkReply>
@@ -26,6 +27,10 @@ Q_OBJECT
     int primary_group_id;
     QNetworkAccessManager qnam;
     QHash<QUrl, std::function<void(Comms *, QByteArray buffer)>> commsReplies; // see https://stackoverflow.com/a/7582574/8538394
+    QFutureWatcher<QHash<qint64, TaskPtr>> tasksWatcher; // tasks reply being parsed on the thread pool
+    bool tasksPending = false;
+
+    void publishParsedTasks();
 
 public:
 
@@ -64,6 +69,7 @@ public slots:
     void userInfoReply(QByteArray buffer);
     void settingsReply(QByteArray buffer);
     void tasksReply(QByteArray buffer);
+    void waitForTasks(); // blocks until a tasks reply being parsed is published
     void genericReply(QNetworkReply *reply);
     void checkBatchSize();
     void clearLastApp();
@@ -0,0 +1,233 @@
+#include "ActivityTrace.h"
+
+#include <atomic>
+
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+
+// write to disk in chunks; a trace of a whole day is a few hundred KB anyway
+static const int TRACE_WRITE_CHUNK = 64 * 1024;
+
+ActivityTraceWriter::ActivityTraceWriter(const QString &path)
+    : file(path)
+{
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "[ActivityTrace] Can't write trace:" << path;
+        return;
+    }
+    buffer.reserve(TRACE_WRITE_CHUNK);
+    buffer.append(TRACE_MAGIC, TRACE_MAGIC_SIZE);
+    stringIds.insert(QString(), 0);
+    clock.start();
+}
+
+ActivityTraceWriter::~ActivityTraceWriter()
+{
+    flush();
+}
+
+bool ActivityTraceWriter::isOpen() const
+{
+    return file.isOpen();
+}
+
+void ActivityTraceWriter::appendVarint(quint64 value)
+{
+    while (value >= 0x80) {
+        buffer.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.append(static_cast<char>(value));
+}
+
+quint32 ActivityTraceWriter::intern(const QString &string)
+{
+    auto found = stringIds.constFind(string);
+    if (found != stringIds.constEnd()) {
+        return found.value();
+    }
+
+    auto id = static_cast<quint32>(stringIds.size());
+    QByteArray utf8 = string.toUtf8();
+    buffer.append(static_cast<char>(TRACE_TAG_STRING));
+    appendVarint(static_cast<quint64>(utf8.size()));
+    buffer.append(utf8);
+    stringIds.insert(string, id);
+    return id;
+}
+
+void ActivityTraceWriter::write(const QString &appName, const QString &windowName, const QString &additionalInfo, quint32 idleMs)
+{
+    if (!file.isOpen()) {
+        return;
+    }
+
+    // strings have to be defined before the event that uses them
+    quint32 appId = intern(appName);
+    quint32 titleId = intern(windowName);
+    quint32 urlId = intern(additionalInfo);
+
+    qint64 now = clock.elapsed();
+    buffer.append(static_cast<char>(TRACE_TAG_EVENT));
+    appendVarint(static_cast<quint64>(now - lastEventMs));
+    appendVarint(appId);
+    appendVarint(titleId);
+    appendVarint(urlId);
+    appendVarint(idleMs);
+    lastEventMs = now;
+
+    if (buffer.size() >= TRACE_WRITE_CHUNK) {
+        flush();
+    }
+}
+
+void ActivityTraceWriter::flush()
+{
+    if (file.isOpen() && !buffer.isEmpty()) {
+        file.write(buffer);
+        file.flush();
+        buffer.clear();
+    }
+}
+
+ActivityTraceReader::ActivityTraceReader(const QString &path)
+    : file(path)
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "[ActivityTrace] Can't read trace:" << path;
+        return;
+    }
+    rewind();
+}
+
+bool ActivityTraceReader::isBinaryTrace(const QString &path)
+{
+    QFile traceFile(path);
+    if (!traceFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return traceFile.read(TRACE_MAGIC_SIZE) == QByteArray(TRACE_MAGIC, TRACE_MAGIC_SIZE);
+}
+
+bool ActivityTraceReader::isOpen() const
+{
+    return file.isOpen();
+}
+
+void ActivityTraceReader::rewind()
+{
+    strings.clear();
+    strings.append(QString());
+    lastEventMs = 0;
+    file.seek(0);
+    if (file.read(TRACE_MAGIC_SIZE) != QByteArray(TRACE_MAGIC, TRACE_MAGIC_SIZE)) {
+        qWarning() << "[ActivityTrace] Not a binary trace:" << file.fileName();
+        file.close();
+    }
+}
+
+bool ActivityTraceReader::readVarint(quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        char byte;
+        if (!file.getChar(&byte)) {
+            return false;
+        }
+        value |= static_cast<quint64>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false; // longer than any varint we write - corrupted file
+}
+
+bool ActivityTraceReader::readString(quint32 id, QString &string) const
+{
+    if (id >= static_cast<quint32>(strings.size())) {
+        return false;
+    }
+    string = strings.at(static_cast<int>(id));
+    return true;
+}
+
+bool ActivityTraceReader::readNext(ActivityTraceEvent &event)
+{
+    char tag;
+    while (file.isOpen() && file.getChar(&tag)) {
+        if (tag == TRACE_TAG_STRING) {
+            quint64 length;
+            if (!readVarint(length)) {
+                break;
+            }
+            QByteArray utf8 = file.read(static_cast<qint64>(length));
+            if (static_cast<quint64>(utf8.size()) != length) {
+                break;
+            }
+            strings.append(QString::fromUtf8(utf8));
+        } else if (tag == TRACE_TAG_EVENT) {
+            quint64 delta, appId, titleId, urlId, idle;
+            if (!readVarint(delta) || !readVarint(appId) || !readVarint(titleId) || !readVarint(urlId) || !readVarint(idle)) {
+                break;
+            }
+            if (!readString(static_cast<quint32>(appId), event.appName)
+                || !readString(static_cast<quint32>(titleId), event.windowName)
+                || !readString(static_cast<quint32>(urlId), event.additionalInfo)) {
+                qWarning() << "[ActivityTrace] Event uses an undefined string, trace is corrupted";
+                return false;
+            }
+            lastEventMs += static_cast<qint64>(delta);
+            event.msSinceStart = lastEventMs;
+            event.idleMs = static_cast<quint32>(idle);
+            return true;
+        } else {
+            qWarning() << "[ActivityTrace] Unknown record tag" << static_cast<int>(tag) << "- trace is corrupted";
+            return false;
+        }
+    }
+    return false;
+}
+
+namespace ActivityTrace
+{
+    static QMutex captureMutex;
+    static ActivityTraceWriter *captureWriter = nullptr;
+    static std::atomic<bool> capturing{false};
+    static std::atomic<unsigned long> lastIdleMs{0};
+
+    void startCapture(const QString &path)
+    {
+        QMutexLocker locker(&captureMutex);
+        delete captureWriter;
+        captureWriter = new ActivityTraceWriter(path);
+        capturing = captureWriter->isOpen();
+        if (capturing) {
+            qInfo() << "[ActivityTrace] Capturing activity to" << path;
+        }
+    }
+
+    void stopCapture()
+    {
+        QMutexLocker locker(&captureMutex);
+        capturing = false;
+        delete captureWriter; // flushes
+        captureWriter = nullptr;
+    }
+
+    void capture(const QString &appName, const QString &windowName, const QString &additionalInfo)
+    {
+        if (!capturing) {
+            return;
+        }
+        QMutexLocker locker(&captureMutex); // events come from the capture thread and from idle checks on the main thread
+        if (captureWriter != nullptr) {
+            captureWriter->write(appName, windowName, additionalInfo, static_cast<quint32>(lastIdleMs.load()));
+        }
+    }
+
+    void noteIdleTime(unsigned long idleMs)
+    {
+        lastIdleMs = idleMs;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef THEGUI_ACTIVITYTRACE_H
+#define THEGUI_ACTIVITYTRACE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Binary activity trace ("TCTRACE1"):
+// after the 8-byte magic, the file is a stream of records, each starting with a tag byte:
+//  - TRACE_TAG_STRING: varint byte length, UTF-8 bytes; strings get ids 1, 2, 3... in order (0 is "")
+//  - TRACE_TAG_EVENT: varint ms since previous event, varint app, title and url string ids, varint idle ms
+// so every distinct app name, title or URL is stored once, and an event is usually 6-10 bytes.
+
+#define TRACE_MAGIC "TCTRACE1"
+#define TRACE_MAGIC_SIZE 8
+#define TRACE_TAG_STRING 0x01
+#define TRACE_TAG_EVENT 0x02
+
+struct ActivityTraceEvent
+{
+    qint64 msSinceStart = 0;
+    QString appName;
+    QString windowName;
+    QString additionalInfo;
+    quint32 idleMs = 0;
+};
+
+class ActivityTraceWriter
+{
+    Q_DISABLE_COPY(ActivityTraceWriter)
+
+public:
+    explicit ActivityTraceWriter(const QString &path);
+    ~ActivityTraceWriter();
+
+    bool isOpen() const;
+    void write(const QString &appName, const QString &windowName, const QString &additionalInfo, quint32 idleMs);
+    void flush();
+
+private:
+    QFile file;
+    QByteArray buffer;
+    QHash<QString, quint32> stringIds;
+    QElapsedTimer clock;
+    qint64 lastEventMs = 0;
+
+    quint32 intern(const QString &string);
+    void appendVarint(quint64 value);
+};
+
+class ActivityTraceReader
+{
+    Q_DISABLE_COPY(ActivityTraceReader)
+
+public:
+    explicit ActivityTraceReader(const QString &path);
+
+    static bool isBinaryTrace(const QString &path);
+
+    bool isOpen() const;
+    bool readNext(ActivityTraceEvent &event);
+    void rewind();
+
+private:
+    QFile file;
+    QVector<QString> strings;
+    qint64 lastEventMs = 0;
+
+    bool readVarint(quint64 &value);
+    bool readString(quint32 id, QString &string) const;
+};
+
+namespace ActivityTrace
+{
+    void startCapture(const QString &path);
+    void stopCapture();
+
+    // called for every logged activity; does nothing unless capturing
+    void capture(const QString &appName, const QString &windowName, const QString &additionalInfo);
+    void noteIdleTime(unsigned long idleMs);
+}
+
+#endif //THEGUI_ACTIVITYTRACE_H
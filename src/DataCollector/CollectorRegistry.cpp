@@ -0,0 +1,76 @@
+#include "CollectorRegistry.h"
+#include "WindowEvents_Replay.h"
+
+#ifdef Q_OS_LINUX
+#include "WindowEvents_U.h"
+#elif defined(Q_OS_WIN)
+#include "WindowEvents_W.h"
+#else
+#include "WindowEvents_M.h"
+#endif
+
+CollectorRegistry &CollectorRegistry::instance()
+{
+    static CollectorRegistry _instance;
+    return _instance;
+}
+
+QString CollectorRegistry::defaultCollectorName()
+{
+#ifdef Q_OS_LINUX
+    return QStringLiteral("x11");
+#elif defined(Q_OS_WIN)
+    return QStringLiteral("windows");
+#else
+    return QStringLiteral("macos");
+#endif
+}
+
+CollectorRegistry::CollectorRegistry()
+    : selectedName(defaultCollectorName())
+{
+#ifdef Q_OS_LINUX
+    registerCollector("x11", [](const QVariantMap &) -> WindowEvents * { return new WindowEvents_U(); });
+#elif defined(Q_OS_WIN)
+    registerCollector("windows", [](const QVariantMap &) -> WindowEvents * { return new WindowEvents_W(); });
+#else
+    registerCollector("macos", [](const QVariantMap &) -> WindowEvents * { return new WindowEvents_M(); });
+#endif
+
+    registerCollector("replay", [](const QVariantMap &options) -> WindowEvents *
+    {
+        return new WindowEvents_Replay(options.value("trace").toString(),
+                                       options.value("speed", 1.0).toDouble(),
+                                       options.value("loop", false).toBool());
+    });
+}
+
+void CollectorRegistry::registerCollector(const QString &name, Factory factory)
+{
+    factories.insert(name, std::move(factory));
+}
+
+QStringList CollectorRegistry::collectorNames() const
+{
+    QStringList names = factories.keys();
+    names.sort();
+    return names;
+}
+
+void CollectorRegistry::select(const QString &name, const QVariantMap &options)
+{
+    if (!factories.contains(name)) {
+        qWarning() << "[Collectors] Unknown collector" << name << "- using" << defaultCollectorName();
+        selectedName = defaultCollectorName();
+        selectedOptions.clear();
+        return;
+    }
+    selectedName = name;
+    selectedOptions = options;
+}
+
+WindowEvents *CollectorRegistry::createSelected() const
+{
+    qInfo() << "[Collectors] Using collector:" << selectedName;
+    return factories.value(selectedName)(selectedOptions);
+}
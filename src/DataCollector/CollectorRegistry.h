@@ -0,0 +1,43 @@
+#ifndef THEGUI_COLLECTORREGISTRY_H
+#define THEGUI_COLLECTORREGISTRY_H
+
+#include <functional>
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+#include "WindowEvents.h"
+
+/**
+ * @brief Named factories for activity sources ("collectors")
+ *
+ * The OS collector of the current platform and the "replay" collector are registered by default;
+ * WindowEventsManager creates whichever one was selected at startup.
+ */
+class CollectorRegistry
+{
+    Q_DISABLE_COPY(CollectorRegistry)
+
+public:
+    using Factory = std::function<WindowEvents *(const QVariantMap &options)>;
+
+    static CollectorRegistry &instance();
+    static QString defaultCollectorName();
+
+    void registerCollector(const QString &name, Factory factory);
+    QStringList collectorNames() const;
+
+    void select(const QString &name, const QVariantMap &options = QVariantMap());
+    WindowEvents *createSelected() const;
+
+private:
+    CollectorRegistry();
+
+    QHash<QString, Factory> factories;
+    QString selectedName;
+    QVariantMap selectedOptions;
+};
+
+#endif //THEGUI_COLLECTORREGISTRY_H
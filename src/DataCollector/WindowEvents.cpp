@@ -1,10 +1,17 @@
+#include <mutex>
+
 #include "WindowEvents.h"
+#include "ActivityTrace.h"
 #include "src/Comms.h"
-#include "src/Settings.h"
+#include "src/SettingsSnapshot.h"
+#include "src/Metrics.h"
+#include "src/Tracing.h"
+#include "src/StartupProfile.h"
 
 bool WindowEvents::wasIdleLongEnoughToStopTracking()
 {
     this->currentIdleTimestamp = getIdleTime();
+    ActivityTrace::noteIdleTime(currentIdleTimestamp);
 
 //    unsigned long diff = currentIdleTimestamp; // - lastIdleTimestamp;
 //    qDebug() << "time diff: " << currentIdleTimestamp;
@@ -16,10 +23,10 @@ bool WindowEvents::wasIdleLongEnoughToStopTracking()
 
 void WindowEvents::checkIdleStatus()
 {
-    QSettings settings;
-    switchToIdleTimeAfterMS = settings.value(QString("SETT_WEB_") + QString("idletime")).toUInt() * 60 * 1000;
-    showAwayPopupAfterMS = settings.value(QString("SETT_WEB_") + QString("logofflinemin")).toUInt() * 60 * 1000;
-    shouldShowAwayPopup = settings.value(QString("SETT_WEB_") + QString("logoffline")).toBool();
+    const SettingsSnapshot &settings = SettingsService::instance().current();
+    switchToIdleTimeAfterMS = settings.idleTimeMS;
+    showAwayPopupAfterMS = settings.awayPopupAfterMS;
+    shouldShowAwayPopup = settings.showAwayPopup;
 
     lastIdleTimestamp = currentIdleTimestamp;
     bool wasPreviousIdle = lastIdleTimestamp > switchToIdleTimeAfterMS;
@@ -46,7 +53,16 @@ void WindowEvents::checkIdleStatus()
 AppData * WindowEvents::logAppName(QString appName, QString windowName, QString additionalInfo)
 {
 //    qDebug("APP: %s | %s\nADD_INFO: %s \n", appName.toLatin1().constData(), windowName.toLatin1().constData(), additionalInfo.toLatin1().constData());
+    TRACE_SCOPE("WindowEvents::logAppName");
+    static MetricCounter &capturedEvents = Metrics::instance().counter("capture_events_total", "Activities reported by the collector");
+    static MetricHistogram &captureTime = Metrics::instance().histogram("capture_log_app_us", "Handling one reported activity, saving included");
+    MetricTimer timer(captureTime);
+    capturedEvents.add();
+    static std::once_flag firstActivity;
+    std::call_once(firstActivity, [] { StartupProfile::mark("first_activity"); });
+
     AppData *app = new AppData(appName.trimmed(), windowName.trimmed(), additionalInfo.trimmed());
+    ActivityTrace::capture(app->getAppName(), app->getWindowName(), app->getAdditionalInfo());
     Comms::instance().saveApp(app);
     return app;
 }
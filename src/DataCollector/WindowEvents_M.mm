@@ -7,7 +7,7 @@
 
 #include <QTimer>
 
-#include "src/FirefoxUtils.h"
+#include "src/BrowserSessionWatcher.h"
 
 //#import <Foundation/Foundation.h>
 
@@ -72,6 +72,8 @@ void WindowEvents_M::run()
 {
     qInfo("thread started");
 
+    BrowserSessionWatcher::instance(); // start parsing browser sessions before the first browser event
+
 //    QTimer *timer = new QTimer();
 //    connect(timer, SIGNAL(timeout()), this, SLOT(GetActiveApp()));
 //    connect(timer, &QTimer::timeout, this, &WindowEvents_M::GetActiveApp);
@@ -314,7 +316,7 @@ QString WindowEvents_M::GetAdditionalInfo(QString processName)
             executed = true;
 
         } else if (processName == "firefox") {
-            additionalInfo = getCurrentURLFromFirefox();
+            additionalInfo = BrowserSessionWatcher::instance().firefoxURL();
             qDebug() << "[FirefoxURL] Found: " << additionalInfo;
 
             executed = false; //this should be false, because we don't have apple script object initialize here
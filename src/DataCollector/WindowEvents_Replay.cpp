@@ -0,0 +1,156 @@
+#include "WindowEvents_Replay.h"
+
+#include <utility>
+
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+
+#include "ActivityTrace.h"
+#include "src/Settings.h"
+
+WindowEvents_Replay::WindowEvents_Replay(QString tracePath, double speed, bool loop)
+    : tracePath(std::move(tracePath)), speed(speed), loop(loop)
+{
+}
+
+unsigned long WindowEvents_Replay::getIdleTime()
+{
+    return replayedIdleMs;
+}
+
+QString WindowEvents_Replay::unescapeField(const QString &field)
+{
+    if (!field.contains('\\')) {
+        return field;
+    }
+
+    QString result;
+    result.reserve(field.size());
+    for (int i = 0; i < field.size(); i++) {
+        if (field[i] == '\\' && i + 1 < field.size()) {
+            QChar next = field[++i];
+            if (next == 't') {
+                result += '\t';
+            } else if (next == 'n') {
+                result += '\n';
+            } else {
+                result += next;
+            }
+        } else {
+            result += field[i];
+        }
+    }
+    return result;
+}
+
+bool WindowEvents_Replay::waitUntil(qint64 msSinceStart, qint64 replayStartedAt)
+{
+    if (speed <= 0) {
+        return !isInterruptionRequested();
+    }
+
+    // schedule against the replay start, so sleeping inaccuracy doesn't add up over a long trace
+    auto dueAt = replayStartedAt + static_cast<qint64>(msSinceStart / speed);
+    qint64 now;
+    while ((now = QDateTime::currentMSecsSinceEpoch()) < dueAt) {
+        if (isInterruptionRequested()) {
+            return false;
+        }
+        QThread::msleep(static_cast<unsigned long>(qMin<qint64>(dueAt - now, 100)));
+    }
+    return !isInterruptionRequested();
+}
+
+bool WindowEvents_Replay::replayEvent(const ActivityTraceEvent &event, qint64 replayStartedAt)
+{
+    if (!waitUntil(event.msSinceStart, replayStartedAt)) {
+        return false;
+    }
+    replayedIdleMs = event.idleMs;
+    logAppName(event.appName, event.windowName, event.additionalInfo);
+    return true;
+}
+
+qint64 WindowEvents_Replay::replayTextTrace()
+{
+    QFile traceFile(tracePath);
+    if (!traceFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "[Replay] Can't open trace:" << tracePath;
+        return 0;
+    }
+
+    QTextStream in(&traceFile);
+    in.setCodec("UTF-8");
+
+    qint64 eventCount = 0;
+    ActivityTraceEvent event;
+    do {
+        qint64 replayStartedAt = QDateTime::currentMSecsSinceEpoch();
+        in.seek(0);
+
+        while (!in.atEnd()) {
+            QString line = in.readLine();
+            if (line.isEmpty() || line.startsWith('#')) {
+                continue;
+            }
+
+            QVector<QStringRef> fields = line.splitRef('\t');
+            if (fields.size() < 5) {
+                qWarning() << "[Replay] Skipping malformed line:" << line.left(MAX_LOG_TEXT_LENGTH);
+                continue;
+            }
+
+            event.msSinceStart = fields[0].toLongLong();
+            event.appName = unescapeField(fields[1].toString());
+            event.windowName = unescapeField(fields[2].toString());
+            event.additionalInfo = unescapeField(fields[3].toString());
+            event.idleMs = fields[4].toUInt();
+            if (!replayEvent(event, replayStartedAt)) {
+                return eventCount;
+            }
+            eventCount++;
+        }
+    } while (loop && !isInterruptionRequested());
+
+    return eventCount;
+}
+
+qint64 WindowEvents_Replay::replayBinaryTrace()
+{
+    ActivityTraceReader reader(tracePath);
+    if (!reader.isOpen()) {
+        return 0;
+    }
+
+    qint64 eventCount = 0;
+    ActivityTraceEvent event;
+    do {
+        qint64 replayStartedAt = QDateTime::currentMSecsSinceEpoch();
+        reader.rewind();
+
+        while (reader.readNext(event)) {
+            if (!replayEvent(event, replayStartedAt)) {
+                return eventCount;
+            }
+            eventCount++;
+        }
+    } while (loop && !isInterruptionRequested());
+
+    return eventCount;
+}
+
+void WindowEvents_Replay::run()
+{
+    qInfo() << "[Replay] thread started, trace:" << tracePath << "speed:" << speed;
+
+    qint64 eventCount;
+    if (ActivityTraceReader::isBinaryTrace(tracePath)) {
+        eventCount = replayBinaryTrace();
+    } else {
+        eventCount = replayTextTrace();
+    }
+
+    qInfo() << "[Replay] thread stopped after" << eventCount << "events";
+}
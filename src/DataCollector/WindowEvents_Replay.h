@@ -0,0 +1,44 @@
+#ifndef WINDOWEVENTS_REPLAY_H
+#define WINDOWEVENTS_REPLAY_H
+
+#include <atomic>
+
+#include <QString>
+
+#include "WindowEvents.h"
+
+struct ActivityTraceEvent;
+
+/**
+ * @brief Synthetic collector, feeds a recorded trace instead of reading the OS
+ *
+ * Trace is either a binary trace (see ActivityTrace.h, written with --capture-trace),
+ * or a text file, one event per line:
+ * `<ms since trace start>\t<app name>\t<window title>\t<url>\t<idle ms>`
+ * with `\t`, `\n` and `\\` escaped; empty lines and lines starting with `#` are skipped.
+ *
+ * Speed is a multiplier of the recorded pace (100 = 100x faster), 0 replays as fast as possible.
+ */
+class WindowEvents_Replay : public WindowEvents
+{
+public:
+    WindowEvents_Replay(QString tracePath, double speed, bool loop);
+
+protected:
+    void run() override;
+    unsigned long getIdleTime() override;
+
+private:
+    QString tracePath;
+    double speed;
+    bool loop;
+    std::atomic<unsigned long> replayedIdleMs{0};
+
+    bool waitUntil(qint64 msSinceStart, qint64 replayStartedAt);
+    bool replayEvent(const ActivityTraceEvent &event, qint64 replayStartedAt);
+    qint64 replayTextTrace();
+    qint64 replayBinaryTrace();
+    static QString unescapeField(const QString &field);
+};
+
+#endif // WINDOWEVENTS_REPLAY_H
@@ -1,201 +1,301 @@
 #include "WindowEvents_U.h"
 
-#include <X11/Xlib.h>
-#include <X11/Xutil.h>
-#include <X11/Xatom.h>
-#include <X11/extensions/scrnsaver.h>
+#include <poll.h>
+#include <cstdlib>
 
-#include <src/FirefoxUtils.h>
-#include <src/ChromeUtils.h>
+#include <QFile>
 
-unsigned long WindowEvents_U::getIdleTime()
+#include <xcb/screensaver.h>
+
+#include <src/BrowserProfileRegistry.h>
+#include <src/BrowserSessionWatcher.h>
+#include <src/Metrics.h>
+
+// how long we sleep in poll() before checking if the thread should stop
+static const int EVENT_WAIT_TIMEOUT_MS = 500;
+
+static xcb_window_t rootWindowOf(xcb_connection_t *connection, int screenNumber)
 {
-    XScreenSaverInfo *info = XScreenSaverAllocInfo();
-    Display *display;
+    xcb_screen_iterator_t it = xcb_setup_roots_iterator(xcb_get_setup(connection));
+    for (; it.rem; --screenNumber, xcb_screen_next(&it)) {
+        if (screenNumber == 0) {
+            return it.data->root;
+        }
+    }
+    return XCB_WINDOW_NONE;
+}
 
-    display = XOpenDisplay(NULL);
+static QString propertyToString(xcb_get_property_reply_t *reply, xcb_atom_t utf8Atom)
+{
+    if (reply == nullptr || reply->format != 8) {
+        return QString();
+    }
+    int length = xcb_get_property_value_length(reply);
+    if (length <= 0) {
+        return QString();
+    }
+    auto *value = static_cast<const char *>(xcb_get_property_value(reply));
+    if (reply->type == utf8Atom) {
+        return QString::fromUtf8(value, length);
+    }
+    return QString::fromLatin1(value, length); // WM_NAME is usually STRING (Latin-1)
+}
 
-    if (display == nullptr) {
-        qInfo() << "[WindowEvents_U::getIdleTime] GetIdleTime failed";
-    } else {
-        XScreenSaverQueryInfo(display, DefaultRootWindow(display), info);
-        XCloseDisplay(display);
-        return info->idle;
+static quint32 propertyToCardinal(xcb_get_property_reply_t *reply)
+{
+    if (reply == nullptr || reply->format != 32 || xcb_get_property_value_length(reply) < 4) {
+        return 0;
     }
+    return *static_cast<quint32 *>(xcb_get_property_value(reply));
+}
 
-    return 0;
+WindowEvents_U::~WindowEvents_U()
+{
+    if (idleConnection != nullptr) {
+        xcb_disconnect(idleConnection);
+    }
 }
 
-std::string WindowEvents_U::execCommand(const char *cmd)
+unsigned long WindowEvents_U::getIdleTime()
 {
-    std::array<char, 128> buffer;
-    std::string result;
-    std::shared_ptr<FILE> pipe(popen(cmd, "r"), pclose);
-    if (!pipe) throw std::runtime_error("popen() failed!");
-    while (!feof(pipe.get())) {
-        if (fgets(buffer.data(), 128, pipe.get()) != nullptr) {
-            result += buffer.data();
+    // keep one connection open, instead of connecting to X every 2 seconds
+    if (idleConnection == nullptr) {
+        int screenNumber = 0;
+        idleConnection = xcb_connect(nullptr, &screenNumber);
+        if (xcb_connection_has_error(idleConnection)) {
+            qInfo() << "[WindowEvents_U::getIdleTime] GetIdleTime failed";
+            xcb_disconnect(idleConnection);
+            idleConnection = nullptr;
+            return 0;
         }
+        idleRoot = rootWindowOf(idleConnection, screenNumber);
     }
-    return result;
+
+    xcb_screensaver_query_info_cookie_t cookie = xcb_screensaver_query_info(idleConnection, idleRoot);
+    xcb_screensaver_query_info_reply_t *info = xcb_screensaver_query_info_reply(idleConnection, cookie, nullptr);
+    if (info == nullptr) {
+        qInfo() << "[WindowEvents_U::getIdleTime] GetIdleTime failed";
+        if (xcb_connection_has_error(idleConnection)) { // X went away; reconnect on next call
+            xcb_disconnect(idleConnection);
+            idleConnection = nullptr;
+        }
+        return 0;
+    }
+
+    unsigned long idle = info->ms_since_user_input;
+    free(info);
+    return idle;
+}
+
+QString WindowEvents_U::readProcessName(quint32 pid)
+{
+    // same value `ps -o comm=` prints, without forking a process for it
+    QFile commFile(QString("/proc/%1/comm").arg(pid));
+    if (!commFile.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromLocal8Bit(commFile.readAll()).trimmed();
 }
 
 void WindowEvents_U::logAppName(QString appName, QString windowName)
 {
-    AppData *app;
     QString additionalInfo = "";
 
-    if (appName == "firefox") {
-        app = WindowEvents::logAppName(appName, windowName, appName); // set additionalInfo to appName for now
-        additionalInfo = getCurrentURLFromFirefox(); // somewhat unreliable - data is usually a few seconds late into the file
-    } else if (appName == "chrome") {
-        app = WindowEvents::logAppName(appName, windowName, appName); // same as above, just to skip the "Internet" checker
-        additionalInfo = getCurrentURLFromChrome(windowName); // somewhat unreliable - might not get the URL
+    // URLs come from the session watcher's memory, so we can resolve them before logging;
+    // they are somewhat unreliable - browsers write the session a few seconds late
+    QString browser = BrowserProfileRegistry::browserForProcess(appName);
+    if (browser == "firefox") {
+        additionalInfo = BrowserSessionWatcher::instance().firefoxURL();
+    } else if (!browser.isEmpty()) {
+        additionalInfo = BrowserSessionWatcher::instance().chromiumURL(browser, windowName);
     }
 
-    if (additionalInfo != "") {
-        app->setAdditionalInfo(additionalInfo); // after we get the URL, update additionalInfo
-    } else {
-        WindowEvents::logAppName(appName, windowName, additionalInfo);
+    if (additionalInfo.isEmpty() && !browser.isEmpty()) {
+        additionalInfo = appName; // no URL yet, but still skip the "Internet" checker
     }
+
+    WindowEvents::logAppName(appName, windowName, additionalInfo);
 }
 
-void WindowEvents_U::run()
+bool WindowEvents_U::internAtoms(xcb_connection_t *connection)
 {
-    qInfo("thread started");
-    Display *display;
-    Window root;
-    XEvent event;
+    // send all requests first, then collect the replies - one round-trip instead of four
+    xcb_intern_atom_cookie_t activeWindowCookie = xcb_intern_atom(connection, 0, 18, "_NET_ACTIVE_WINDOW");
+    xcb_intern_atom_cookie_t wmNameCookie = xcb_intern_atom(connection, 0, 12, "_NET_WM_NAME");
+    xcb_intern_atom_cookie_t wmPidCookie = xcb_intern_atom(connection, 0, 11, "_NET_WM_PID");
+    xcb_intern_atom_cookie_t utf8Cookie = xcb_intern_atom(connection, 0, 11, "UTF8_STRING");
 
-    display = XOpenDisplay(nullptr);
+    xcb_intern_atom_cookie_t cookies[] = {activeWindowCookie, wmNameCookie, wmPidCookie, utf8Cookie};
+    xcb_atom_t *atoms[] = {&NET_ACTIVE_WINDOW, &NET_WM_NAME, &NET_WM_PID, &UTF8_STRING};
 
-    if (display == nullptr) {
-        qInfo("[WindowEvents_U] Error: XOpenDisplay");
-        return;
+    bool allFound = true;
+    for (int i = 0; i < 4; i++) {
+        xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(connection, cookies[i], nullptr);
+        if (reply == nullptr) {
+            allFound = false;
+            continue;
+        }
+        *atoms[i] = reply->atom;
+        free(reply);
+    }
+    return allFound;
+}
+
+void WindowEvents_U::handleWindowSwitch(xcb_connection_t *connection, xcb_window_t &currentWindow, xcb_window_t newWindow)
+{
+    // stop listening to title changes of the old window, but keep DestroyNotify so its cache entry gets dropped
+    if (currentWindow != XCB_WINDOW_NONE) {
+        const uint32_t oldWindowMask = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+        xcb_change_window_attributes(connection, currentWindow, XCB_CW_EVENT_MASK, &oldWindowMask);
     }
 
-    Atom NET_ACTIVE_WINDOW = XInternAtom(display, "_NET_ACTIVE_WINDOW", false);
-    Atom NET_WM_NAME = XInternAtom(display, "_NET_WM_NAME", false);  // UTF-8
-    Atom WM_NAME = XInternAtom(display, "WM_NAME", false);           // Legacy encoding
-    Atom NET_WM_PID = XInternAtom(display, "_NET_WM_PID", false);           // Legacy encoding
+    const uint32_t newWindowMask = XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    xcb_change_window_attributes(connection, newWindow, XCB_CW_EVENT_MASK, &newWindowMask);
 
-    root = XDefaultRootWindow(display);
+    currentWindow = newWindow;
+}
+
+void WindowEvents_U::logCurrentWindow(xcb_connection_t *connection, xcb_window_t window)
+{
+    // queue up every request we need for this window; they all go out in one flush
+    xcb_get_property_cookie_t netNameCookie = xcb_get_property(connection, 0, window, NET_WM_NAME, UTF8_STRING, 0, UINT32_MAX);
+    xcb_get_property_cookie_t nameCookie = xcb_get_property(connection, 0, window, XCB_ATOM_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT32_MAX);
 
-    XSelectInput(display, root, PropertyChangeMask);
+    auto cached = windowCache.constFind(window);
+    bool needsPid = (cached == windowCache.constEnd());
+    xcb_get_property_cookie_t pidCookie{};
+    if (needsPid) {
+        pidCookie = xcb_get_property(connection, 0, window, NET_WM_PID, XCB_ATOM_CARDINAL, 0, 1);
+    }
 
-    Atom actual_type;
-    int actual_format;
-    unsigned long nitems;
-    unsigned long bytes;
-    long *data;
-    unsigned char *window_name;
-    unsigned char *pid;
-    std::string app_name;
-    int status;
-    long xwindowid_old = 0;
-    long xwindowid_curr = 0;
+    xcb_get_property_reply_t *netNameReply = xcb_get_property_reply(connection, netNameCookie, nullptr);
+    xcb_get_property_reply_t *nameReply = xcb_get_property_reply(connection, nameCookie, nullptr);
+    QString windowName = propertyToString(netNameReply, UTF8_STRING);
+    if (windowName.isEmpty()) {
+        windowName = propertyToString(nameReply, UTF8_STRING); // legacy apps only set WM_NAME
+    }
+    free(netNameReply);
+    free(nameReply);
 
-    while (!QThread::currentThread()->isInterruptionRequested()) {
-        XNextEvent(display, &event);
-        // if it's not a property notify, we don't want to process it
-        if (event.type != PropertyNotify) {
-            continue;
+    WindowInfo info;
+    if (needsPid) {
+        xcb_get_property_reply_t *pidReply = xcb_get_property_reply(connection, pidCookie, nullptr);
+        info.pid = propertyToCardinal(pidReply);
+        free(pidReply);
+        if (info.pid != 0) {
+            info.appName = readProcessName(info.pid);
         }
-        // if not one of the properties we want, skip it too
-        if (!(event.xproperty.atom == NET_ACTIVE_WINDOW || event.xproperty.atom == NET_WM_NAME || event.xproperty.atom == WM_NAME)) {
-            continue;
+        // some clients set _NET_WM_PID after they're mapped; only a complete lookup is kept, the rest is asked again
+        if (info.pid != 0 && !info.appName.isEmpty()) {
+            windowCache.insert(window, info);
         }
+    } else {
+        info = *cached;
+    }
 
-        // get active window
-        status = XGetWindowProperty(
-            display,
-            root,
-            NET_ACTIVE_WINDOW,
-            0,
-            (~0L),
-            False,
-            AnyPropertyType,
-            &actual_type,
-            &actual_format,
-            &nitems,
-            &bytes,
-            (unsigned char **) &data);
-
-        if (status != Success) {
-            qInfo("[WindowEvents_U] Error of status = %d\n", status);
-            continue;
-        }
+    if (info.pid == 0) {
+        qInfo("[WindowEvents_U] Error: pid was NULL");
+        return;
+    }
 
-        // if it's another window, listen to the new window, and ignore old window
-        if (xwindowid_curr != data[0] && data[0] != 0) {
-            XSelectInput(display, xwindowid_old, NoEventMask); // don't fetch events from old window
+    // save the app name and window name
+    logAppName(info.appName, windowName);
+}
 
-            xwindowid_old = xwindowid_curr; // what was current is now old
-            xwindowid_curr = data[0];       // set new "current"
+void WindowEvents_U::run()
+{
+    qInfo("thread started");
 
-            XSelectInput(display, xwindowid_curr, PropertyChangeMask);
-        }
+    BrowserSessionWatcher::instance(); // start parsing browser sessions before the first browser event
 
-        // get the window name
-        status = XGetWindowProperty(
-            display,
-            xwindowid_curr,
-            NET_WM_NAME,
-            0,
-            (~0L),
-            False,
-            AnyPropertyType,
-            &actual_type,
-            &actual_format,
-            &nitems,
-            &bytes,
-            &window_name);
-
-        if (status != Success) {
-            qInfo("[WindowEvents_U] Error of status = %d\n", status);
-            continue;
+    int screenNumber = 0;
+    xcb_connection_t *connection = xcb_connect(nullptr, &screenNumber);
+
+    if (xcb_connection_has_error(connection)) {
+        qInfo("[WindowEvents_U] Error: xcb_connect");
+        xcb_disconnect(connection);
+        return;
+    }
+
+    xcb_window_t root = rootWindowOf(connection, screenNumber);
+    if (root == XCB_WINDOW_NONE || !internAtoms(connection)) {
+        qInfo("[WindowEvents_U] Error: no root window or atoms");
+        xcb_disconnect(connection);
+        return;
+    }
+
+    const uint32_t rootMask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_change_window_attributes(connection, root, XCB_CW_EVENT_MASK, &rootMask);
+    xcb_flush(connection);
+
+    pollfd connectionPoll{};
+    connectionPoll.fd = xcb_get_file_descriptor(connection);
+    connectionPoll.events = POLLIN;
+
+    xcb_window_t currentWindow = XCB_WINDOW_NONE;
+    bool activeWindowChanged = true; // read whatever is active right now
+    bool titleChanged = false;
+    MetricCounter &handledEvents = Metrics::instance().counter("capture_x11_events_total", "X events handled by the Linux collector");
+
+    while (!QThread::currentThread()->isInterruptionRequested()) {
+        // drain the whole burst of events first, then ask X once about the state after it
+        xcb_generic_event_t *event;
+        while ((event = xcb_poll_for_event(connection)) != nullptr) {
+            switch (event->response_type & ~0x80) {
+                case XCB_PROPERTY_NOTIFY: {
+                    auto *propertyEvent = reinterpret_cast<xcb_property_notify_event_t *>(event);
+                    if (propertyEvent->window == root && propertyEvent->atom == NET_ACTIVE_WINDOW) {
+                        activeWindowChanged = true;
+                    } else if (propertyEvent->window == currentWindow
+                        && (propertyEvent->atom == NET_WM_NAME || propertyEvent->atom == XCB_ATOM_WM_NAME)) {
+                        titleChanged = true;
+                    }
+                    break;
+                }
+                case XCB_DESTROY_NOTIFY: {
+                    auto *destroyEvent = reinterpret_cast<xcb_destroy_notify_event_t *>(event);
+                    windowCache.remove(destroyEvent->window);
+                    break;
+                }
+                default:
+                    break; // includes errors of failed property reads - those are handled by NULL replies
+            }
+            free(event);
+            handledEvents.add();
         }
 
-        // get the window PID
-        status = XGetWindowProperty(
-            display,
-            xwindowid_curr,
-            NET_WM_PID,
-            0,
-            (~0L),
-            False,
-            AnyPropertyType,
-            &actual_type,
-            &actual_format,
-            &nitems,
-            &bytes,
-            &pid);
-
-        if (status != Success) {
-            qInfo("[WindowEvents_U] Error of status = %d\n", status);
-            continue;
+        if (xcb_connection_has_error(connection)) {
+            qInfo("[WindowEvents_U] Error: lost connection to X server");
+            break;
         }
-        if (pid == nullptr) {
-            qInfo("[WindowEvents_U] Error: pid was NULL");
+
+        if (!activeWindowChanged && !titleChanged) {
+            // nothing to do; wait for X, but wake up now and then to check for interruption
+            connectionPoll.revents = 0;
+            poll(&connectionPoll, 1, EVENT_WAIT_TIMEOUT_MS);
             continue;
         }
 
-        // convert PID to a usable number
-        auto *longarr = reinterpret_cast<long *>(pid);
-        long longpid = longarr[0];
+        if (activeWindowChanged) {
+            xcb_get_property_cookie_t activeCookie = xcb_get_property(connection, 0, root, NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 0, 1);
+            xcb_get_property_reply_t *activeReply = xcb_get_property_reply(connection, activeCookie, nullptr);
+            xcb_window_t activeWindow = propertyToCardinal(activeReply);
+            free(activeReply);
 
-        // use `ps` to get the process name
-        std::string command = "";
-        command += "ps ";
-        command += " -o comm= ";
-        command += QString::number(longpid).toStdString();
-//                qInfo() << QString::fromStdString(command);
-        app_name = execCommand(command.c_str());
+            // if it's another window, listen to the new window, and ignore old window
+            if (activeWindow != XCB_WINDOW_NONE && activeWindow != currentWindow) {
+                handleWindowSwitch(connection, currentWindow, activeWindow);
+            }
+            activeWindowChanged = false;
+        }
 
-        // save the app name and window name
-        logAppName(QString::fromStdString(app_name), QString::fromUtf8((char *) window_name));
+        if (currentWindow != XCB_WINDOW_NONE) {
+            logCurrentWindow(connection, currentWindow);
+        }
+        titleChanged = false;
     }
 
-    XCloseDisplay(display);
+    xcb_disconnect(connection);
+    windowCache.clear();
     qInfo("thread stopped");
 }
@@ -1,23 +1,43 @@
 #ifndef WindowEvents_U_H
 #define WindowEvents_U_H
 
-#include <exception>
-#include <iostream>
-#include <string>
-#include <array>
-#include <memory>
-#include <sstream>
+#include <QHash>
+#include <xcb/xcb.h>
+
 #include "WindowEvents.h"
 
 class WindowEvents_U : public WindowEvents
 {
+public:
+    ~WindowEvents_U() override;
+
 protected:
     void run() override; // your thread implementation goes here
     unsigned long getIdleTime() override;
     void logAppName(QString appName, QString windowName);
 
 private:
-    static std::string execCommand(const char *cmd);
+    struct WindowInfo
+    {
+        quint32 pid = 0;
+        QString appName;
+    };
+
+    // window -> owning process; a window can't change its process, so entries live until DestroyNotify
+    QHash<xcb_window_t, WindowInfo> windowCache;
+
+    xcb_connection_t *idleConnection = nullptr;
+    xcb_window_t idleRoot = XCB_WINDOW_NONE;
+
+    xcb_atom_t NET_ACTIVE_WINDOW = XCB_ATOM_NONE;
+    xcb_atom_t NET_WM_NAME = XCB_ATOM_NONE;
+    xcb_atom_t NET_WM_PID = XCB_ATOM_NONE;
+    xcb_atom_t UTF8_STRING = XCB_ATOM_NONE;
+
+    bool internAtoms(xcb_connection_t *connection);
+    void handleWindowSwitch(xcb_connection_t *connection, xcb_window_t &currentWindow, xcb_window_t newWindow);
+    void logCurrentWindow(xcb_connection_t *connection, xcb_window_t window);
+    static QString readProcessName(quint32 pid);
 };
 
 #endif // WindowEvents_U_H
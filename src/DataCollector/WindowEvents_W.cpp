@@ -1,6 +1,9 @@
 #include "WindowEvents_W.h"
 #include "src/ControlIterator/AccControlIterator.h"
 #include "src/ControlIterator/UIAControlIterator.h"
+#include "src/StringKernels.h"
+#include "src/LogCategories.h"
+#include "src/Tracing.h"
 #include <QElapsedTimer>
 #include <QUrl>
 
@@ -28,7 +31,7 @@ void WindowEvents_W::logAppName(QString appName, QString windowName, HWND passed
     if (WindowDetails::instance().isBrowser(appName)) {
         app = WindowEvents::logAppName(appName, windowName, appName); // set additionalInfo to appName for now
         additionalInfo = WindowDetails::instance().GetInfoFromBrowser(passedHwnd); // get real URL
-    } else if (appName.toLower().contains(QRegExp("firefox"))) {
+    } else if (StringKernels::containsCaseInsensitive(appName, QStringLiteral("firefox"))) {
         app = WindowEvents::logAppName(appName, windowName, appName); // same like above, just to skip the "Internet" checker
         additionalInfo = WindowDetails::instance().GetInfoFromFirefox(passedHwnd); // get real URL from Firefox
     }
@@ -278,7 +281,7 @@ bool WindowDetails::standardAccCallback(IControlItem *node, void *userData)
 
 
     if (startsWithGoodProtocol(value)) {
-        qDebug() << "[VAL] " << value;
+        qCDebug(lcBrowserUrl) << "[VAL] " << value;
         if (pStr->isEmpty() || *pStr == QLatin1String("0") || *pStr == QLatin1String("<unknown>")) {
             *pStr = value;
             return false;
@@ -293,7 +296,7 @@ bool WindowDetails::chromeAccCallback(IControlItem *node, void *userData)
     QString value = QString::fromStdWString(node->getValue());
     if (!value.isEmpty() && value != QLatin1String("0") && value != QLatin1String("<unknown>")) {
 //        qDebug() << "[WForegroundApp::chromeAccCallback] Got IControlItem node value = " << value;
-        qDebug() << "[VAL] " << value;
+        qCDebug(lcBrowserUrl) << "[VAL] " << value;
 
         if (node->parent->getRole() == ROLE_SYSTEM_GROUPING && value.contains(URL_REGEX)) {
 //            qDebug("[WForegroundApp::chromeAccCallback] It is a valid URL, so we return it.");
@@ -314,7 +317,7 @@ bool WindowDetails::operaAccCallback(IControlItem *node, void *userData)
     QString value = QString::fromStdWString(node->getValue());
     if (!value.isEmpty() && value != QLatin1String("0") && value != QLatin1String("<unknown>")) {
 //        qDebug() << "[WForegroundApp::operaAccCallback] Got IControlItem node value = " << value;
-        qDebug() << "[VAL] " << value;
+        qCDebug(lcBrowserUrl) << "[VAL] " << value;
 
         if (value.contains(URL_REGEX)) {
 //            qDebug("[WForegroundApp::operaAccCallback] It is a valid URL, so we return it.");
@@ -368,9 +371,24 @@ WindowDetails::WindowDetails()
 
 bool WindowDetails::isBrowser(QString processName)
 {
+    static const QStringList standardAccBrowsers{
+        QStringLiteral("iexplore"), QStringLiteral("mosaic"), QStringLiteral("maxthon"),
+        QStringLiteral("safari")
+    };
+    static const QStringList chromeAccBrowsers{
+        QStringLiteral("chrome"), QStringLiteral("epic"), QStringLiteral("opera"), QStringLiteral("cent"),
+        QStringLiteral("slimjet"), QStringLiteral("sleipnir"), QStringLiteral("silk"),
+        QStringLiteral("blisk"), QStringLiteral("yandex"), QStringLiteral("iron")
+    };
+    static const QStringList operaAccBrowsers{
+        QStringLiteral("microsoftedge"), QStringLiteral("netscp6"), QStringLiteral("mozilla"),
+        QStringLiteral("netscape"), QStringLiteral("vivaldi"), QStringLiteral("brave"),
+        QStringLiteral("ucbrowser"), QStringLiteral("browser")
+    };
+
     // iexplore gets only first tab (!)
     // all others were not checked
-    if (processName.toLower().contains(QRegExp("iexplore|mosaic|maxthon|safari"))) {
+    if (StringKernels::containsAnyCaseInsensitive(processName, standardAccBrowsers)) {
         pointerMagic = &WindowDetails::standardAccCallback;
         return true;
     }
@@ -384,7 +402,7 @@ bool WindowDetails::isBrowser(QString processName)
             Epic Privacy Browser: epic.exe - works
             all other - not checked
      */
-    if (processName.toLower().contains(QRegExp("chrome|epic|opera|cent|slimjet|sleipnir|silk|blisk|yandex|iron"))) {
+    if (StringKernels::containsAnyCaseInsensitive(processName, chromeAccBrowsers)) {
         pointerMagic = &WindowDetails::chromeAccCallback;
         return true;
     }
@@ -400,7 +418,7 @@ bool WindowDetails::isBrowser(QString processName)
             Brave: brave.exe - STILL broken; nothing works at all
             UC Browser: UCBrowser.exe -STILL broken; nothing works at all
      */
-    if (processName.toLower().contains(QRegExp("microsoftedge|netscp6|mozilla|netscape|vivaldi|brave|ucbrowser|browser"))) {
+    if (StringKernels::containsAnyCaseInsensitive(processName, operaAccBrowsers)) {
         pointerMagic = &WindowDetails::operaAccCallback;
         return true;
     }
@@ -410,6 +428,7 @@ bool WindowDetails::isBrowser(QString processName)
 
 QString WindowDetails::GetInfoFromFirefox(HWND passedHwnd)
 {
+    TRACE_SCOPE("WindowDetails::GetInfoFromFirefox");
     if (passedHwnd == NULL) {
         currenthwnd = GetForegroundWindow();
     } else {
@@ -420,15 +439,14 @@ QString WindowDetails::GetInfoFromFirefox(HWND passedHwnd)
     timer.start();
     QString res = QString::fromStdWString(FirefoxURL::GetFirefoxURL(currenthwnd));
 
-    qDebug() << "[FX_W]" << res;
-    QUrl url(res);
-    QString host = url.host();
-    qDebug() << "[HOST]" << host << "(" << timer.elapsed() << ")" << "ms" << "\r\n";
+    qCDebug(lcBrowserUrl) << "[FX_W]" << res;
+    qCDebug(lcBrowserUrl) << "[HOST]" << QUrl(res).host() << "(" << timer.elapsed() << ")" << "ms" << "\r\n";
     return res; // we do [HOST] here for debug only, but we save full URL to DB
 }
 
 QString WindowDetails::GetInfoFromBrowser(HWND passedHwnd)
 {
+    TRACE_SCOPE("WindowDetails::GetInfoFromBrowser");
     if (passedHwnd == NULL) {
         currenthwnd = GetForegroundWindow();
     } else {
@@ -441,17 +459,15 @@ QString WindowDetails::GetInfoFromBrowser(HWND passedHwnd)
     AccControlIterator iterator;
     iterator.iterate(currenthwnd, this, pointerMagic, (void *) &res, true);
 
-    qDebug() << "[ACC] " << res;
+    qCDebug(lcBrowserUrl) << "[ACC] " << res;
 
     if (res == "" && WindowEvents_W::getWindowsVersion() <= 6.0) {
         UIAControlIterator iterator2;
         iterator2.iterate(currenthwnd, this, pointerMagic, (void *) &res, true);
-        qDebug() << "[UIA] " << res;// << "\r\n";
+        qCDebug(lcBrowserUrl) << "[UIA] " << res;// << "\r\n";
     }
 
-    QUrl url(res);
-    QString host = url.host();
-    qDebug() << "[HOST]" << host << "(" << timer.elapsed() << ")" << "ms" << "\r\n";
+    qCDebug(lcBrowserUrl) << "[HOST]" << QUrl(res).host() << "(" << timer.elapsed() << ")" << "ms" << "\r\n";
     return res;
 }
 
@@ -1,5 +1,7 @@
 #include "DbManager.h"
 #include "Settings.h"
+#include "Metrics.h"
+#include "Tracing.h"
 
 #include <QSqlError>
 #include <QSqlRecord>
@@ -49,8 +51,10 @@ void DbManager::prepareQueries()
     // but this will hopefully prevent crashes
     addAppQuery = QSqlQuery(m_db);
     getAppsQuery = QSqlQuery(m_db);
+    countAppsQuery = QSqlQuery(m_db);
     addAppQuery.prepare("INSERT INTO apps (ID, app_name, window_name, additional_info, start_time, end_time) VALUES (NULL, ?, ?, ?, ?, ?)");
     getAppsQuery.prepare("SELECT app_name, window_name, additional_info, start_time, end_time FROM apps WHERE start_time > :lastSync LIMIT :maxCount");
+    countAppsQuery.prepare("SELECT COUNT(*) FROM apps WHERE start_time > :lastSync");
 }
 
 bool DbManager::createTable()
@@ -65,11 +69,23 @@ bool DbManager::createTable()
         TableCreated = false;
     }
 
+    // unsynced activities are looked up by start_time on every sync; older DBs get the index too
+    QSqlQuery createIndexQuery;
+    if (!createIndexQuery.exec("CREATE INDEX IF NOT EXISTS apps_start_time ON apps (start_time)")) {
+        qWarning() << "[DB] Warning: Couldn't create the start_time index: " << createIndexQuery.lastError();
+    }
+
     return TableCreated;
 }
 
 bool DbManager::saveAppToDb(AppData *app)
 {
+    TRACE_SCOPE("DbManager::saveAppToDb");
+    static MetricCounter &savedCount = Metrics::instance().counter("db_saved_activities_total", "Activities saved to the local DB");
+    static MetricCounter &failedCount = Metrics::instance().counter("db_save_errors_total", "Activities that couldn't be saved to the local DB");
+    static MetricHistogram &saveTime = Metrics::instance().histogram("db_save_activity_us", "Saving one activity to the local DB");
+    MetricTimer timer(saveTime);
+
     bool success = false;
     if (!this->isOpen()) {
         qInfo("[DB] ERROR1 can't query yet - DB is not opened");
@@ -99,6 +115,7 @@ bool DbManager::saveAppToDb(AppData *app)
         qInfo() << "[DB] ERROR4 adding failed: missing values!";
     }
 
+    (success ? savedCount : failedCount).add();
     return success;
 }
 
@@ -110,6 +127,10 @@ QVector<AppData> DbManager::getAppsSinceLastSync(qint64 last_sync)
         return appList; // return empty appList if DB is not opened
     }
 
+    TRACE_SCOPE("DbManager::getAppsSinceLastSync");
+    static MetricHistogram &fetchTime = Metrics::instance().histogram("db_fetch_unsynced_us", "Reading the next batch of unsynced activities");
+    MetricTimer timer(fetchTime);
+
     getAppsQuery.bindValue(":lastSync", last_sync);
     getAppsQuery.bindValue(":maxCount", MAX_ACTIVITIES_BATCH_SIZE);
 
@@ -134,18 +155,31 @@ QVector<AppData> DbManager::getAppsSinceLastSync(qint64 last_sync)
     return appList;
 }
 
-void DbManager::addToTaskList(Task *impTask) {
-    taskList.insert(impTask->getTaskId(), impTask);
+int DbManager::countAppsSinceLastSync(qint64 last_sync)
+{
+    if (!this->isOpen()) {
+        return -1;
+    }
+    countAppsQuery.bindValue(":lastSync", last_sync);
+    if (!countAppsQuery.exec() || !countAppsQuery.next()) {
+        return -1;
+    }
+    int count = countAppsQuery.value(0).toInt();
+    countAppsQuery.finish();
+    return count;
 }
 
-void DbManager::clearTaskList() {
-    taskList.clear();
+TaskCatalogPtr DbManager::getTaskCatalog() const {
+    return std::atomic_load(&taskCatalog);
 }
 
-const QHash<qint64, Task *> &DbManager::getTaskList() const {
-    return taskList;
+TaskPtr DbManager::getTaskById(qint64 taskId) const {
+    return getTaskCatalog()->task(taskId);
 }
 
-Task *DbManager::getTaskById(qint64 taskId) {
-    return taskList.value(taskId);
+void DbManager::publishTaskCatalog(QHash<qint64, TaskPtr> tasks) {
+    // readers holding the previous catalog keep it (and its tasks) alive until they let go
+    quint64 generation = getTaskCatalog()->generation() + 1;
+    std::atomic_store(&taskCatalog, std::make_shared<const TaskCatalog>(std::move(tasks), generation));
+    emit taskListChanged();
 }
@@ -8,7 +8,7 @@
 #include <QtCore/QHash>
 
 #include "AppData.h"
-#include "Task.h"
+#include "TaskCatalog.h"
 
 class DbManager : public QObject {
 Q_OBJECT
@@ -29,14 +29,18 @@ public:
     bool createTable();
 
     QVector<AppData> getAppsSinceLastSync(qint64 last_sync);
+    // all of them, not only the next batch; -1 when the DB can't tell
+    int countAppsSinceLastSync(qint64 last_sync);
 
-    QHash<qint64, Task*> taskList; // taskID, taskObj with data
+    // the current task catalog; safe to call from any thread, and the catalog never changes while held
+    TaskCatalogPtr getTaskCatalog() const;
+    TaskPtr getTaskById(qint64 taskId) const;
 
-    const QHash<qint64, Task *> &getTaskList() const;
-    Task * getTaskById(qint64 taskId);
+    // replaces the catalog with one made of these tasks, then lets indexes catch up
+    void publishTaskCatalog(QHash<qint64, TaskPtr> tasks);
 
-    void addToTaskList(Task*);
-    void clearTaskList();
+signals:
+    void taskListChanged();
 
 public slots:
 
@@ -52,6 +56,9 @@ private:
     QSqlDatabase m_db;
     QSqlQuery addAppQuery;
     QSqlQuery getAppsQuery;
+    QSqlQuery countAppsQuery;
+
+    TaskCatalogPtr taskCatalog = std::make_shared<const TaskCatalog>(); // only through std::atomic_load / atomic_store
 };
 
 #endif // DBMANAGER_H
@@ -9,21 +9,13 @@
 
 #include "FirefoxUtils.h"
 
-#include <sys/stat.h>
-
-#include <vector>
-#include <algorithm>
+#include <climits>
+#include <cstring>
 
-#include <QDir>
 #include <QFile>
-#include <QTextStream>
-#include <QStandardPaths>
+#include <QFileInfo>
 #include <QDebug>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QJsonValue>
-#include <cstring>
+#include <QVector>
 
 #include "third-party/mozilla_lz4/lz4.h"
 
@@ -31,287 +23,411 @@ const char mozlz4_magic[] = {109, 111, 122, 76, 122, 52, 48, 0};  /* "mozLz40\0"
 const int decomp_size = 4;  /* 4 bytes size come after the header */
 const size_t magic_size = sizeof mozlz4_magic;
 
-bool comparatorGreater(const std::pair<QString, time_t> &left, const std::pair<QString, time_t> &right)
-{
-    return left.second > right.second;
-}
-
-void *readFileToMemory(const char *filename, size_t *readSize)
-{
-    size_t filesize = 0;
-    void *returnValue = 0;
-    qDebug() << "[FirefoxUtils-readFileToMemory] Reading file: " << filename;
-    FILE *fileDescriptor = fopen(filename, "rb");
-
-    if (!fileDescriptor) {
-        qDebug("[FirefoxUtils-readFileToMemory] No file descriptor");
-        goto cleanup;
-    }
-
-    if (fseek(fileDescriptor, 0, SEEK_END) < 0) {
-        qDebug("[FirefoxUtils-readFileToMemory] Can't read anymore");
-        goto cleanup;
-    }
-
-    filesize = static_cast<size_t>(ftell(fileDescriptor));
-    fseek(fileDescriptor, 0, SEEK_SET);
-
-    if (!(returnValue = malloc(filesize))) {
-        qDebug("[FirefoxUtils-readFileToMemory] Can't alloc values");
-        goto cleanup;
-    }
-
-    if (filesize != fread(returnValue, 1, filesize, fileDescriptor)) {
-        free(returnValue);
-        returnValue = 0;
-    }
-
-    cleanup:
-    if (fileDescriptor) {
-        fclose(fileDescriptor);
-    }
-
-    if (returnValue && readSize) {
-        *readSize = filesize;
-    }
-
-    return returnValue;
-}
-
-QString parseJsRecoveryFilePath(const QString &recoveryFilePath)
+QByteArray parseJsRecoveryFilePath(const QString &recoveryFilePath)
 {
     QFile file(recoveryFilePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         return "";
     }
-
-    QTextStream in(&file);
-
-    QString content;
-
-    while (!in.atEnd()) {
-        content += in.readLine();
-    }
-
-    return content;
+    return file.readAll();
 }
 
-QString parseJsonlz4RecoveryFilePath(const QString &recoveryFilePath)
+QByteArray parseJsonlz4RecoveryFilePath(const QString &recoveryFilePath)
 {
-    char *encryptedData = 0;
-    char *decryptedData = 0;
+    // one buffer per thread, only ever grown; sessions are a few MB and get parsed over and over
+    static thread_local QByteArray decompressionBuffer;
 
-    size_t readSize = 0;
-    size_t outputBufferSize = 0;
-
-    std::string str_recoveryFilePath = recoveryFilePath.toStdString();
-    char *cstr_recoveryFilePath = new char[str_recoveryFilePath.length() + 1];
-    std::strcpy(cstr_recoveryFilePath, str_recoveryFilePath.c_str());
-
-    // QString -> std::wstring -> wchar_t* -> cast to char* | because old function works(TM)
-
-    if (!(encryptedData = (char *) readFileToMemory(cstr_recoveryFilePath, &readSize))) {
+    QFile file(recoveryFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
         qDebug() << "[FirefoxUtils::parseJsonlz4RecoveryFilePath] Can't read file: " + recoveryFilePath;
-        delete[] cstr_recoveryFilePath;
         return "";
     }
-    delete[] cstr_recoveryFilePath;
 
-    if (readSize < magic_size + decomp_size || memcmp(mozlz4_magic, encryptedData, magic_size)) {
+    qint64 fileSize = file.size();
+    if (fileSize < static_cast<qint64>(magic_size + decomp_size) || fileSize > INT_MAX) {
         qDebug() << "[FirefoxUtils::parseJsonlz4RecoveryFilePath] Unsupported file format: " + recoveryFilePath;
         return "";
     }
 
-    size_t i = 0;
-    for (i = magic_size; i < magic_size + decomp_size; i++) {
-        outputBufferSize += (unsigned char) encryptedData[i] << (8 * (i - magic_size));
-    }
-
-    if (!(decryptedData = (char *) malloc(outputBufferSize))) {
-        qDebug() << "[FirefoxUtils::parseJsonlz4RecoveryFilePath] Failed to allocate a buffer for an output.";
+    // read the compressed data straight from the page cache; unmapped when the file closes
+    const uchar *mappedData = file.map(0, fileSize);
+    if (mappedData == nullptr) {
+        qDebug() << "[FirefoxUtils::parseJsonlz4RecoveryFilePath] Can't map file: " + recoveryFilePath;
         return "";
     }
 
-    int decryptedDataSize = LZ4_decompress_safe(encryptedData + i, decryptedData, (int) (readSize - i), (int) outputBufferSize);
-    if (decryptedDataSize < 0) {
-        qDebug() << "[FirefoxUtils::parseJsonlz4RecoveryFilePath] Failed to decompress a file: " + recoveryFilePath;
-        free(decryptedData);
+    if (memcmp(mozlz4_magic, mappedData, magic_size) != 0) {
+        qDebug() << "[FirefoxUtils::parseJsonlz4RecoveryFilePath] Unsupported file format: " + recoveryFilePath;
         return "";
     }
-    QString qDecryptedData = QString(decryptedData);
-    free(decryptedData);
-
-    int indexOfLastProperChar = qDecryptedData.lastIndexOf("}");
-    QString cutData = qDecryptedData.left(indexOfLastProperChar + 1);
-
-//    qDebug() << "[FirefoxUtils::parseJsonlz4RecoveryFilePath] Successfully decompressed a file: " + recoveryFilePath;
-    QString filename = "D:/fx.json";
-    QFile file(filename);
-    if (file.open(QIODevice::ReadWrite)) {
-        QTextStream stream(&file);
-        stream << cutData;
-    }
-    return cutData;
-}
 
-QString getFirefoxConfigFilePath()
-{
-#ifdef Q_OS_LINUX
-    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::HomeLocation).first();
-    QString firefoxPath = homeDir + "/.mozilla/firefox";
-#elif defined(Q_OS_WIN)
-    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::HomeLocation).first();
-    QString firefoxPath = homeDir + "/AppData/Roaming/Mozilla/Firefox/Profiles";
-#else
-    QString homeDir = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation).first();
-    QString firefoxPath = homeDir + "/Firefox/Profiles";
-#endif
-
-    QDir firefoxDir(firefoxPath);
-    if (!firefoxDir.isReadable()) {
-        qDebug() << "Error: " + firefoxPath + " not found";
-        return "";
+    size_t outputBufferSize = 0;
+    for (int i = 0; i < decomp_size; i++) {
+        outputBufferSize += static_cast<size_t>(mappedData[magic_size + i]) << (8 * i);
     }
-
-    firefoxDir.setFilter(QDir::Dirs | QDir::Readable);
-
-
-    QStringList dirsList = firefoxDir.entryList(QStringList("*.default"), QDir::Dirs | QDir::Readable);
-    if (dirsList.empty()) {
-        qDebug() << "Error: *.default directory not found in " + firefoxPath;
+    if (outputBufferSize > INT_MAX) {
+        qDebug() << "[FirefoxUtils::parseJsonlz4RecoveryFilePath] Unsupported file size: " + recoveryFilePath;
         return "";
     }
 
-    QString filename = firefoxPath + "/" + dirsList.first();
-
-    QString sessionStoreFile = filename + "/sessionstore.js";
-    QString recoveryFile = filename + "/sessionstore-backups/recovery.js";
-    QString lz4RecoveryFile = filename + "/sessionstore-backups/recovery.jsonlz4";
-
-    /* Here I need to check both files js and jsonlz4 and detect which one was written last. */
-    QString configFilePath;
-    struct stat attributes;
-    std::vector<std::pair<QString, time_t> > sessionFilesVector;
-
-    if (QFile::exists(lz4RecoveryFile)) {
-        stat((char *) lz4RecoveryFile.toStdWString().c_str(), &attributes);
-        sessionFilesVector.push_back(std::make_pair(lz4RecoveryFile, attributes.st_mtime));
-        configFilePath = lz4RecoveryFile;
-    }
-
-    if (QFile::exists(sessionStoreFile)) {
-        stat((char *) sessionStoreFile.toStdWString().c_str(), &attributes);
-        sessionFilesVector.push_back(std::make_pair(sessionStoreFile, attributes.st_mtime));
-        configFilePath = sessionStoreFile;
+    if (static_cast<size_t>(decompressionBuffer.size()) < outputBufferSize) {
+        decompressionBuffer.resize(static_cast<int>(outputBufferSize));
     }
 
-    if (QFile::exists(recoveryFile)) {
-        stat((char *) recoveryFile.toStdWString().c_str(), &attributes);
-        sessionFilesVector.push_back(std::make_pair(recoveryFile, attributes.st_mtime));
-        configFilePath = recoveryFile;
-    }
-
-    /* If vector is empty - return empty string. */
-    if (sessionFilesVector.size() == 0) {
+    const char *compressedData = reinterpret_cast<const char *>(mappedData) + magic_size + decomp_size;
+    int compressedSize = static_cast<int>(fileSize - magic_size - decomp_size);
+    int decryptedDataSize = LZ4_decompress_safe(compressedData, decompressionBuffer.data(), compressedSize, static_cast<int>(outputBufferSize));
+    if (decryptedDataSize < 0) {
+        qDebug() << "[FirefoxUtils::parseJsonlz4RecoveryFilePath] Failed to decompress a file: " + recoveryFilePath;
         return "";
     }
-        /*
-            If there is only one element then we don't have
-            multiple sessions/Firefox versions running.
-            No need to sort here.
-        */
-    else if (sessionFilesVector.size() == 1) {
-        return sessionFilesVector.front().first;
-    }
 
-    /* Here we sort std::vector to determine which file was written last. */
-    std::sort(sessionFilesVector.begin(), sessionFilesVector.end(), comparatorGreater);
-
-    return sessionFilesVector.front().first;
+    // no copy - valid until the next call on this thread
+    return QByteArray::fromRawData(decompressionBuffer.constData(), decryptedDataSize);
 }
 
-QString getCurrentURLFromFirefoxConfig(QString &jsonConfig)
+namespace
 {
-
-    QJsonParseError error{};
-    auto json = QJsonDocument::fromJson(jsonConfig.toUtf8(), &error);
-    if(error.error != QJsonParseError::NoError){
-        qDebug() << "JSON parse error: " << error.errorString();
-        return "";
-    }
-    auto jsonObject = json.object();
-    auto jsonArray = jsonObject.value("properties").toArray();
-
-    auto selectedWindowJson = jsonObject.value("selectedWindow");
-    if (selectedWindowJson.isNull() || selectedWindowJson.isUndefined()) {
-        qDebug() << "Failed getting 'selectedWindow'";
-        return "";
-    }
-
-    int selectedWindow = selectedWindowJson.toInt() - 1;
-
-    auto windowsJsonArray = jsonObject.value("windows");
-    if (windowsJsonArray.isNull() || windowsJsonArray.isUndefined()) {
-        qDebug() << "Failed getting 'windows'";
-        return "";
-    }
-
-    auto windowJson = windowsJsonArray.toArray()[selectedWindow];
-    if (windowJson.isNull() || windowJson.isUndefined()) {
-        qDebug() << "Failed getting selected window";
-        return "";
-    }
-
-    auto selectedTabJson = windowJson.toObject().value("selected");
-    if (selectedTabJson.isNull() || selectedTabJson.isUndefined()) {
-        qDebug() << "Failed getting 'selected' value for tab";
-        return "";
-    }
-
-    int selectedTab = selectedTabJson.toInt() - 1;
-
-    auto tabsJson = windowJson.toObject().value("tabs");
-    if (tabsJson.isNull() || tabsJson.isUndefined()) {
-        qDebug() << "Failed getting 'tabs'";
-        return "";
-    }
-
-    auto tabJson = tabsJson.toArray()[selectedTab];
-    if (tabJson.isNull() || tabJson.isUndefined()) {
-        qDebug() << "Failed getting selected tab";
-        return "";
-    }
-
-    auto entriesJson = tabJson.toObject().value("entries");
-    if (entriesJson.isNull() || entriesJson.isUndefined()) {
-        qDebug() << "Failed getting 'entries'";
-        return "";
-    }
-
-    auto entriesJsonArray = entriesJson.toArray();
-    int lastEntryIndex = entriesJsonArray.size() - 1;
-
-    auto lastEntryJson = entriesJson.toArray()[lastEntryIndex];
-    if (lastEntryJson.isNull() || lastEntryJson.isUndefined()) {
-        qDebug() << "Failed getting last entry";
-        return "";
+    // Walks the session JSON without building it: containers we don't need are skipped
+    // by counting brackets, and only the path to the selected tab's last entry is looked into.
+    // Offsets of array elements are remembered, because "selectedWindow" and "selected"
+    // come after the arrays they index into.
+    class SessionJsonScanner
+    {
+    public:
+        SessionJsonScanner(const char *data, int size)
+            : end(data + size), position(data) {}
+
+        void seek(const char *newPosition)
+        {
+            position = newPosition;
+        }
+
+        // calls onKey(key, keyLength) positioned at the key's value; values onKey doesn't read are skipped,
+        // returning false from onKey stops the walk
+        template<typename Callback>
+        bool forEachKey(Callback onKey)
+        {
+            if (!consume('{')) {
+                return false;
+            }
+            if (consume('}')) {
+                return true;
+            }
+            do {
+                const char *key;
+                int keyLength;
+                if (!readRawString(key, keyLength) || !consume(':')) {
+                    return false;
+                }
+                skipWhitespace();
+                const char *valueStart = position;
+                if (!onKey(key, keyLength)) {
+                    return true;
+                }
+                if (position == valueStart && !skipValue()) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume('}');
+        }
+
+        // start of every element of the array at the current position
+        bool arrayElements(QVector<const char *> &elements)
+        {
+            elements.clear();
+            if (!consume('[')) {
+                return false;
+            }
+            if (consume(']')) {
+                return true;
+            }
+            do {
+                skipWhitespace();
+                elements.append(position);
+                if (!skipValue()) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume(']');
+        }
+
+        bool readInt(int &value)
+        {
+            skipWhitespace();
+            bool negative = position < end && *position == '-';
+            if (negative) {
+                position++;
+            }
+            if (position >= end || *position < '0' || *position > '9') {
+                return false;
+            }
+            value = 0;
+            while (position < end && *position >= '0' && *position <= '9') {
+                value = value * 10 + (*position++ - '0');
+            }
+            if (negative) {
+                value = -value;
+            }
+            return true;
+        }
+
+        bool readString(QString &value)
+        {
+            const char *raw;
+            int rawLength;
+            if (!readRawString(raw, rawLength)) {
+                return false;
+            }
+            if (memchr(raw, '\\', static_cast<size_t>(rawLength)) == nullptr) {
+                value = QString::fromUtf8(raw, rawLength);
+                return true;
+            }
+
+            value.clear();
+            const char *rawEnd = raw + rawLength;
+            while (raw < rawEnd) {
+                auto escape = static_cast<const char *>(memchr(raw, '\\', static_cast<size_t>(rawEnd - raw)));
+                if (escape == nullptr) {
+                    escape = rawEnd;
+                }
+                value += QString::fromUtf8(raw, static_cast<int>(escape - raw));
+                if (escape + 1 >= rawEnd) {
+                    break;
+                }
+                raw = escape + 2;
+                switch (escape[1]) {
+                    case 'b': value += '\b'; break;
+                    case 'f': value += '\f'; break;
+                    case 'n': value += '\n'; break;
+                    case 'r': value += '\r'; break;
+                    case 't': value += '\t'; break;
+                    case 'u':
+                        if (rawEnd - raw >= 4) {
+                            value += QChar(QByteArray(raw, 4).toUShort(nullptr, 16)); // surrogate pairs come as two escapes
+                            raw += 4;
+                        }
+                        break;
+                    default: value += QLatin1Char(escape[1]); break; // \" \\ \/
+                }
+            }
+            return true;
+        }
+
+        bool skipValue()
+        {
+            skipWhitespace();
+            if (position >= end) {
+                return false;
+            }
+            char first = *position;
+            if (first == '"') {
+                const char *ignored;
+                int ignoredLength;
+                return readRawString(ignored, ignoredLength);
+            }
+            if (first != '{' && first != '[') {
+                // number, true, false, null
+                while (position < end && *position != ',' && *position != '}' && *position != ']') {
+                    position++;
+                }
+                return true;
+            }
+
+            int depth = 0;
+            while (position < end) {
+                char c = *position++;
+                if (c == '"') {
+                    position--;
+                    const char *ignored;
+                    int ignoredLength;
+                    if (!readRawString(ignored, ignoredLength)) {
+                        return false;
+                    }
+                } else if (c == '{' || c == '[') {
+                    depth++;
+                } else if (c == '}' || c == ']') {
+                    if (--depth == 0) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+    private:
+        const char *end;
+        const char *position;
+
+        void skipWhitespace()
+        {
+            while (position < end && (*position == ' ' || *position == '\n' || *position == '\r' || *position == '\t')) {
+                position++;
+            }
+        }
+
+        bool consume(char expected)
+        {
+            skipWhitespace();
+            if (position < end && *position == expected) {
+                position++;
+                return true;
+            }
+            return false;
+        }
+
+        // string contents without the quotes, escapes left as they are
+        bool readRawString(const char *&raw, int &rawLength)
+        {
+            if (!consume('"')) {
+                return false;
+            }
+            const char *start = position;
+            while (position < end) {
+                auto quote = static_cast<const char *>(memchr(position, '"', static_cast<size_t>(end - position)));
+                if (quote == nullptr) {
+                    return false;
+                }
+                // the quote is escaped if an odd number of backslashes precede it
+                const char *backslash = quote;
+                while (backslash > start && backslash[-1] == '\\') {
+                    backslash--;
+                }
+                position = quote + 1;
+                if ((quote - backslash) % 2 == 0) {
+                    raw = start;
+                    rawLength = static_cast<int>(quote - start);
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    bool keyIs(const char *key, int keyLength, const char *expected)
+    {
+        return static_cast<size_t>(keyLength) == strlen(expected) && memcmp(key, expected, static_cast<size_t>(keyLength)) == 0;
     }
+}
 
-    auto urlJson = lastEntryJson.toObject().value("url");
-    if (urlJson.isNull() || urlJson.isUndefined()) {
+QString getCurrentURLFromFirefoxConfig(const QByteArray &jsonConfig)
+{
+    SessionJsonScanner scanner(jsonConfig.constData(), jsonConfig.size());
+    QVector<const char *> elements;
+
+    // windows[selectedWindow - 1]
+    const char *selectedWindowStart = nullptr;
+    {
+        QVector<const char *> windows;
+        int selectedWindow = 0;
+        bool windowsFound = false;
+        bool selectedWindowFound = false;
+        bool parsed = scanner.forEachKey([&](const char *key, int keyLength)
+        {
+            if (keyIs(key, keyLength, "windows")) {
+                windowsFound = scanner.arrayElements(windows);
+            } else if (keyIs(key, keyLength, "selectedWindow")) {
+                selectedWindowFound = scanner.readInt(selectedWindow);
+            }
+            return !(windowsFound && selectedWindowFound);
+        });
+        if (!parsed) {
+            qDebug() << "JSON parse error in Firefox session";
+            return "";
+        }
+        if (!selectedWindowFound) {
+            qDebug() << "Failed getting 'selectedWindow'";
+            return "";
+        }
+        if (!windowsFound) {
+            qDebug() << "Failed getting 'windows'";
+            return "";
+        }
+        if (selectedWindow < 1 || selectedWindow > windows.size()) {
+            qDebug() << "Failed getting selected window";
+            return "";
+        }
+        selectedWindowStart = windows[selectedWindow - 1];
+    }
+
+    // .tabs[selected - 1]
+    const char *selectedTabStart = nullptr;
+    {
+        int selectedTab = 0;
+        bool tabsFound = false;
+        bool selectedFound = false;
+        scanner.seek(selectedWindowStart);
+        scanner.forEachKey([&](const char *key, int keyLength)
+        {
+            if (keyIs(key, keyLength, "tabs")) {
+                tabsFound = scanner.arrayElements(elements);
+            } else if (keyIs(key, keyLength, "selected")) {
+                selectedFound = scanner.readInt(selectedTab);
+            }
+            return !(tabsFound && selectedFound);
+        });
+        if (!selectedFound) {
+            qDebug() << "Failed getting 'selected' value for tab";
+            return "";
+        }
+        if (!tabsFound) {
+            qDebug() << "Failed getting 'tabs'";
+            return "";
+        }
+        if (selectedTab < 1 || selectedTab > elements.size()) {
+            qDebug() << "Failed getting selected tab";
+            return "";
+        }
+        selectedTabStart = elements[selectedTab - 1];
+    }
+
+    // .entries[last]
+    const char *lastEntryStart = nullptr;
+    {
+        bool entriesFound = false;
+        scanner.seek(selectedTabStart);
+        scanner.forEachKey([&](const char *key, int keyLength)
+        {
+            if (keyIs(key, keyLength, "entries")) {
+                entriesFound = scanner.arrayElements(elements);
+                return false;
+            }
+            return true;
+        });
+        if (!entriesFound) {
+            qDebug() << "Failed getting 'entries'";
+            return "";
+        }
+        if (elements.isEmpty()) {
+            qDebug() << "Failed getting last entry";
+            return "";
+        }
+        lastEntryStart = elements.last();
+    }
+
+    // .url
+    QString result;
+    bool urlFound = false;
+    scanner.seek(lastEntryStart);
+    scanner.forEachKey([&](const char *key, int keyLength)
+    {
+        if (keyIs(key, keyLength, "url")) {
+            urlFound = scanner.readString(result);
+            return false;
+        }
+        return true;
+    });
+    if (!urlFound) {
         qDebug() << "Failed getting 'url'";
         return "";
     }
 
-    QString result(urlJson.toString());
-
     return result;
 }
 
-QString getCurrentURLFromFirefox()
+QString getCurrentURLFromFirefoxFile(const QString &recoveryFilePath)
 {
-    QString content;
-    QString recoveryFilePath = getFirefoxConfigFilePath();
+    QByteArray content;
     QString recoveryFileExtension = QFileInfo(recoveryFilePath).completeSuffix();
 
     if (recoveryFileExtension == "js") {
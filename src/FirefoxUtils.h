@@ -10,14 +10,13 @@
 
 #pragma once
 
+#include <QByteArray>
 #include <QString>
 
-QString getFirefoxConfigFilePath();
-QString getCurrentURLFromFirefoxConfig(QString &jsonConfig);
+QString getCurrentURLFromFirefoxConfig(const QByteArray &jsonConfig);
 
-void *readFileToMemory(const char *filename, size_t *readSize);
-QString parseJsRecoveryFilePath(const QString &recoveryFilePath);
-QString parseJsonlz4RecoveryFilePath(const QString &recoveryFilePath);
+QByteArray parseJsRecoveryFilePath(const QString &recoveryFilePath);
+// returned bytes point into a per-thread buffer that the next call on the same thread overwrites
+QByteArray parseJsonlz4RecoveryFilePath(const QString &recoveryFilePath);
 
-bool comparatorGreater(const std::pair<QString, time_t> &left, const std::pair<QString, time_t> &right);
-QString getCurrentURLFromFirefox();
+QString getCurrentURLFromFirefoxFile(const QString &recoveryFilePath);
@@ -0,0 +1,129 @@
+#include "KeywordAutomaton.h"
+
+#include <QPair>
+
+#include <algorithm>
+
+static inline quint64 edgeKey(int node, ushort unit)
+{
+    return (static_cast<quint64>(node) << 16) | unit;
+}
+
+int KeywordAutomaton::child(int node, ushort unit) const
+{
+    return edges.value(edgeKey(node, unit), -1);
+}
+
+void KeywordAutomaton::add(const QString &keyword, qint64 id)
+{
+    QString folded = keyword.toCaseFolded();
+    if (folded.isEmpty()) {
+        return;
+    }
+    keywords.append({folded, id});
+    insert(keywords.size() - 1);
+    compiled = false;
+}
+
+void KeywordAutomaton::clear()
+{
+    nodes = QVector<Node>{Node()};
+    edges.clear();
+    keywords.clear();
+    compiled = true;
+}
+
+bool KeywordAutomaton::isEmpty() const
+{
+    return keywordCount() == 0;
+}
+
+int KeywordAutomaton::keywordCount() const
+{
+    return keywords.size();
+}
+
+void KeywordAutomaton::insert(int keywordIndex)
+{
+    int node = 0;
+    for (QChar unit : keywords[keywordIndex].folded) {
+        int next = child(node, unit.unicode());
+        if (next < 0) {
+            next = nodes.size();
+            nodes.append(Node());
+            edges.insert(edgeKey(node, unit.unicode()), next);
+        }
+        node = next;
+    }
+    nodes[node].keywords.append(keywordIndex);
+}
+
+void KeywordAutomaton::compile()
+{
+    if (compiled) {
+        return;
+    }
+    QVector<QVector<QPair<ushort, int>>> children(nodes.size());
+    for (auto it = edges.constBegin(); it != edges.constEnd(); ++it) {
+        children[static_cast<int>(it.key() >> 16)].append(qMakePair(static_cast<ushort>(it.key() & 0xFFFF), it.value()));
+    }
+
+    // breadth first, so a node's failure link (always shallower) is done before the node
+    QVector<int> queue;
+    queue.reserve(nodes.size());
+    queue.append(0);
+    for (int head = 0; head < queue.size(); head++) {
+        int node = queue[head];
+        Node &current = nodes[node];
+
+        current.output = -1;
+        if (node != 0) {
+            const Node &suffix = nodes[current.fail];
+            current.output = !suffix.keywords.isEmpty() ? current.fail : suffix.output;
+        }
+
+        for (const QPair<ushort, int> &edge : qAsConst(children[node])) {
+            int fail = 0;
+            if (node != 0) {
+                fail = nodes[node].fail;
+                int next;
+                while ((next = child(fail, edge.first)) < 0 && fail != 0) {
+                    fail = nodes[fail].fail;
+                }
+                fail = next < 0 ? 0 : next;
+            }
+            nodes[edge.second].fail = fail;
+            queue.append(edge.second);
+        }
+    }
+    compiled = true;
+}
+
+QVector<qint64> KeywordAutomaton::findAll(const QString &text) const
+{
+    Q_ASSERT(compiled);
+    QVector<qint64> ids;
+    if (isEmpty()) {
+        return ids;
+    }
+
+    int node = 0;
+    for (QChar unit : text.toCaseFolded()) {
+        int next;
+        while ((next = child(node, unit.unicode())) < 0 && node != 0) {
+            node = nodes[node].fail;
+        }
+        node = next < 0 ? 0 : next;
+
+        // the keywords ending here are the ones of this node and of its output chain
+        for (int match = !nodes[node].keywords.isEmpty() ? node : nodes[node].output; match > 0; match = nodes[match].output) {
+            for (int keywordIndex : nodes[match].keywords) {
+                ids.append(keywords[keywordIndex].id);
+            }
+        }
+    }
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
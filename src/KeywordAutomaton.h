@@ -0,0 +1,51 @@
+#ifndef TIMECAMPDESKTOP_KEYWORDAUTOMATON_H
+#define TIMECAMPDESKTOP_KEYWORDAUTOMATON_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Aho-Corasick matcher for many case-insensitive keywords at once
+ *
+ * Every keyword has an id (several keywords can share one); findAll() reports the ids of all keywords
+ * that occur in the text, in one pass over it, however many keywords there are.
+ * compile() has to run after adding keywords. There is no removal: TaskRuleEngine is immutable once
+ * shared, so a changed task list is compiled into a new engine on the thread pool (AutoTracking::compileRules).
+ */
+class KeywordAutomaton
+{
+public:
+    void add(const QString &keyword, qint64 id);
+    void clear();
+    void compile();
+
+    bool isEmpty() const;
+    int keywordCount() const;
+    // ids of all keywords found in text, each once, in ascending order
+    QVector<qint64> findAll(const QString &text) const;
+
+private:
+    struct Node
+    {
+        int fail = 0;
+        QVector<int> keywords; // indexes of keywords ending here
+        int output = -1; // closest failure-link suffix that has keywords
+    };
+
+    struct Keyword
+    {
+        QString folded;
+        qint64 id;
+    };
+
+    QVector<Node> nodes{Node()};
+    QHash<quint64, int> edges; // (node << 16 | UTF-16 unit) -> child node
+    QVector<Keyword> keywords;
+    bool compiled = true;
+
+    int child(int node, ushort unit) const;
+    void insert(int keywordIndex);
+};
+
+#endif //TIMECAMPDESKTOP_KEYWORDAUTOMATON_H
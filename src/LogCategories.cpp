@@ -0,0 +1,13 @@
+#include "LogCategories.h"
+
+#ifdef QT_DEBUG
+#define TC_LOG_DEFAULT_LEVEL QtDebugMsg
+#else
+#define TC_LOG_DEFAULT_LEVEL QtInfoMsg
+#endif
+
+Q_LOGGING_CATEGORY(lcNetwork, "timecamp.network", TC_LOG_DEFAULT_LEVEL)
+Q_LOGGING_CATEGORY(lcActivity, "timecamp.activity", TC_LOG_DEFAULT_LEVEL)
+Q_LOGGING_CATEGORY(lcWebView, "timecamp.webview", TC_LOG_DEFAULT_LEVEL)
+Q_LOGGING_CATEGORY(lcBrowserUrl, "timecamp.browserurl", TC_LOG_DEFAULT_LEVEL)
+Q_LOGGING_CATEGORY(lcStartup, "timecamp.startup", TC_LOG_DEFAULT_LEVEL)
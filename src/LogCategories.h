@@ -0,0 +1,22 @@
+#ifndef TIMECAMPDESKTOP_LOGCATEGORIES_H
+#define TIMECAMPDESKTOP_LOGCATEGORIES_H
+
+#include <QLoggingCategory>
+
+/**
+ * Logging categories for the chatty, hot paths (every request, every saved activity, every JS call).
+ *
+ * Use them with qCDebug / qCInfo: the category is checked before any argument is evaluated,
+ * so a disabled message costs one bool load and no string building.
+ * Debug output of these categories is on in debug builds and off in release builds;
+ * turn it on at runtime with QT_LOGGING_RULES="timecamp.*.debug=true".
+ * Configuring with -DTIMECAMP_STRIP_DEBUG_LOG=ON defines QT_NO_DEBUG_OUTPUT and compiles qCDebug out entirely.
+ */
+
+Q_DECLARE_LOGGING_CATEGORY(lcNetwork)   // timecamp.network: requests and replies
+Q_DECLARE_LOGGING_CATEGORY(lcActivity)  // timecamp.activity: saved activities, AutoTracking matches
+Q_DECLARE_LOGGING_CATEGORY(lcWebView)   // timecamp.webview: JS run in the page
+Q_DECLARE_LOGGING_CATEGORY(lcBrowserUrl) // timecamp.browserurl: reading URLs out of browser windows
+Q_DECLARE_LOGGING_CATEGORY(lcStartup)   // timecamp.startup: Qt library locations, found before the tray is up
+
+#endif //TIMECAMPDESKTOP_LOGCATEGORIES_H
@@ -6,8 +6,15 @@
 #include "ui_MainWidget.h"
 
 #include "Settings.h"
+#include "StringKernels.h"
+#include "LogCategories.h"
+#include "PageBridge.h"
+#include "Tracing.h"
 #include "WindowEventsManager.h"
 
+// a hidden page is frozen after this long; see also SETT_WEBVIEW_RELEASE_MINUTES
+static const int WEBVIEW_FREEZE_DELAY_MS = 60 * 1000;
+
 
 MainWidget::MainWidget(QWidget *parent)
     : QWidget(parent), ui(new Ui::MainWidget)
@@ -23,8 +30,23 @@ MainWidget::MainWidget(QWidget *parent)
     palette.setBrush(QPalette::Window, bkgnd);
     this->setPalette(palette);
 
-    // set some defaults
-    loggedIn = false;
+    // set some defaults; until a page says otherwise, having an API key means being logged in
+    QString apiKey = settings.value(SETT_APIKEY).toString().trimmed();
+    loggedIn = !apiKey.isEmpty() && apiKey != "false";
+    applyRecentTasks(QJsonDocument::fromJson(settings.value(SETT_RECENT_TASKS).toByteArray()));
+
+    freezeTimer.setSingleShot(true);
+    freezeTimer.setInterval(WEBVIEW_FREEZE_DELAY_MS);
+    connect(&freezeTimer, &QTimer::timeout, this, &MainWidget::freezeWebview);
+    releaseTimer.setSingleShot(true);
+    connect(&releaseTimer, &QTimer::timeout, this, &MainWidget::releaseWebview);
+    connect(this, &MainWidget::windowStatusChanged, this, &MainWidget::windowVisibilityChanged);
+
+    // the page tells us when its timer, recent tasks or token change
+    pageBridge = new PageBridge(this);
+    connect(pageBridge, &PageBridge::timerChanged, this, &MainWidget::updateTimerStatus);
+    connect(pageBridge, &PageBridge::recentTasksChanged, this, &MainWidget::recentTasksPushed);
+    connect(pageBridge, &PageBridge::tokenChanged, this, &MainWidget::tokenPushed);
 
     this->setMinimumSize(QSize(350, 500));
 //
@@ -52,16 +74,96 @@ MainWidget::~MainWidget()
 
 void MainWidget::init()
 {
+    if (MainWidgetWasInitialised) {
+        return;
+    }
     this->setWindowTitle(WINDOW_NAME);
-    this->setupWebview(); // starts the embedded webpage
     MainWidgetWasInitialised = true;
-    this->wasTheWindowLeftOpened();
+    if (!loggedIn) {
+        this->open(); // the page is where one logs in
+    } else {
+        // the page starts with the window; tell the tray what we know without it
+        emit pageStatusChanged(loggedIn, WINDOW_NAME);
+        this->wasTheWindowLeftOpened();
+    }
+}
+
+void MainWidget::ensureWebview()
+{
+    // QtWebEngine starts its Chromium processes here; that takes seconds, so it's done only when the window opens
+    if (QTWEPage == nullptr) {
+        this->setupWebview();
+    } else if (pageFrozen) {
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
+        QTWEPage->setLifecycleState(QWebEnginePage::LifecycleState::Active);
+#endif
+        pageFrozen = false;
+        this->refreshTimerPageData(); // its data stood still while frozen
+    }
+}
+
+bool MainWidget::isPageLive() const
+{
+    return QTWEPage != nullptr && !pageFrozen;
+}
+
+void MainWidget::windowVisibilityChanged(bool visible)
+{
+    if (visible) {
+        freezeTimer.stop();
+        releaseTimer.stop();
+        return;
+    }
+    if (QTWEPage == nullptr) {
+        return;
+    }
+    freezeTimer.start();
+    int releaseMinutes = settings.value(SETT_WEBVIEW_RELEASE_MINUTES, DEFAULT_WEBVIEW_RELEASE_MINUTES).toInt();
+    if (releaseMinutes > 0) {
+        releaseTimer.start(releaseMinutes * 60 * 1000);
+    }
+}
+
+void MainWidget::freezeWebview()
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
+    // no timers, no JS, no painting; the renderer stays, so reopening is instant
+    if (QTWEPage != nullptr && !isVisible() && !pageFrozen) {
+        QTWEPage->setLifecycleState(QWebEnginePage::LifecycleState::Frozen);
+        pageFrozen = true;
+        qCDebug(lcWebView) << "Page frozen";
+    }
+#endif
+}
+
+void MainWidget::releaseWebview()
+{
+    if (QTWEPage == nullptr || isVisible()) {
+        return;
+    }
+    qCInfo(lcWebView) << "Closing the hidden page, to give its memory back";
+    freezeTimer.stop();
+    // the page before its profile (Qt warns otherwise), the interceptor after the profile that uses it
+    delete QTWEPage;
+    QTWEPage = nullptr;
+    delete QTWEView; // and its profile with it
+    QTWEView = nullptr;
+    QTWEProfile = nullptr;
+    QTWESettings = nullptr;
+    delete TCri;
+    TCri = nullptr;
+    delete refreshBind;
+    refreshBind = nullptr;
+    delete fullscreenBind;
+    fullscreenBind = nullptr;
+    pageFrozen = false;
+    // loggedIn, the API key and recent tasks stay as the page last had them
 }
 
 void MainWidget::handleSpacingEvents()
 {
 //    qInfo("Size: %d x %d", size().width(), size().height());
-    if (MainWidgetWasInitialised) {
+    if (QTWEView != nullptr) {
         this->setUpdatesEnabled(false);
         QTWEView->resize(size()); // resize webview
         settings.setValue("mainWindowGeometry", saveGeometry()); // save window position
@@ -102,16 +204,10 @@ void MainWidget::closeEvent(QCloseEvent *event)
 
 void MainWidget::twoSecTimerTimeout()
 {
+    TRACE_SCOPE("MainWidget::twoSecTimerTimeout");
+    // the page's state isn't polled, PageBridge pushes it
     if (loggedIn) {
         emit checkIsIdle();
-        checkIsTimerRunning();
-        fetchRecentTasks();
-        QString apiKeyStr = settings.value(SETT_APIKEY).toString().trimmed();
-        if (apiKeyStr.isEmpty() || apiKeyStr == "false") {
-            fetchAPIkey();
-        }
-    } else {
-        setApiKey("");
     }
 }
 
@@ -139,6 +235,7 @@ void MainWidget::setupWebview()
 
     QTWEPage = new QWebEnginePage(QTWEProfile, QTWEView);
     QTWEPage->setBackgroundColor(Qt::transparent);
+    pageBridge->attachTo(QTWEPage);
     QTWEView->setPage(QTWEPage);
 
     refreshBind = new QShortcut(QKeySequence::Refresh, this);
@@ -196,16 +293,24 @@ void MainWidget::webpageTitleChanged(QString title)
         this->runJSinPage("jQuery('#about .news').parent().parent().attr('class', 'hidden').siblings().first().attr('class', 'col-xs-12 col-sm-10 col-sm-push-1 col-md-8 col-md-push-2 col-lg-6 col-lg-push-3')");
         LastTasks.clear(); // clear last tasks
         LastTasksCache = QJsonDocument(); // clear the cache
+        settings.remove(SETT_RECENT_TASKS);
         emit lastTasksChanged();
+        setApiKey("");
+        pendingToken.clear();
+    } else if (!pendingToken.isEmpty()) {
+        setApiKey(pendingToken); // pushed before the title told us we're logged in
+        pendingToken.clear();
     }
     emit pageStatusChanged(loggedIn, title);
     this->setWindowTitle(title); // https://trello.com/c/J8dCKeV2/43-niech-tytul-apki-desktopowej-sie-zmienia-
     this->setAttribute(Qt::WA_TranslucentBackground);
-    this->checkIsTimerRunning();
 }
 
 void MainWidget::clearCache()
 {
+    if (QTWEProfile == nullptr) {
+        return; // nothing cached yet
+    }
     this->setUpdatesEnabled(false);
     this->runJSinPage("localStorage.clear()");
     QTWEProfile->clearAllVisitedLinks();
@@ -231,7 +336,12 @@ void MainWidget::webviewFullscreen()
 
 void MainWidget::checkIfLoggedIn(QString title)
 {
-    if (!title.toLower().contains(QRegExp("log in|login|register|create free account|create account|time tracking software|blog"))) {
+    static const QStringList loggedOutTitles{
+        QStringLiteral("log in"), QStringLiteral("login"), QStringLiteral("register"),
+        QStringLiteral("create free account"), QStringLiteral("create account"),
+        QStringLiteral("time tracking software"), QStringLiteral("blog")
+    };
+    if (!StringKernels::containsAnyCaseInsensitive(title, loggedOutTitles)) {
         loggedIn = true;
     } else {
         loggedIn = false; // when we log out, we need to set this variable again
@@ -240,6 +350,7 @@ void MainWidget::checkIfLoggedIn(QString title)
 
 void MainWidget::open()
 {
+    this->ensureWebview();
     settings.setValue(SETT_WAS_WINDOW_LEFT_OPENED, true); // save if window was opened
     settings.sync();
     restoreGeometry(settings.value("mainWindowGeometry").toByteArray());
@@ -255,7 +366,10 @@ void MainWidget::open()
 
 void MainWidget::runJSinPage(QString js)
 {
-    qDebug() << "Running JS: " << js;
+    if (!isPageLive()) {
+        return; // the page loads, or refreshes when unfrozen, its current state anyway
+    }
+    qCDebug(lcWebView) << "Running JS: " << js.left(MAX_LOG_TEXT_LENGTH);
     QTWEPage->runJavaScript(js);
 }
 
@@ -274,6 +388,7 @@ bool MainWidget::checkIfOnTimerPage()
 
 void MainWidget::goToTimerPage()
 {
+    this->ensureWebview();
     if (!this->checkIfOnTimerPage()) {
         QEventLoop loop;
         QMetaObject::Connection conn1 = QObject::connect(QTWEPage, &QWebEnginePage::loadFinished, &loop, &QEventLoop::quit);
@@ -304,6 +419,7 @@ void MainWidget::goToTimerPage()
 
 void MainWidget::goToAwayPage()
 {
+    this->ensureWebview();
     this->clearCache();
     this->open();
 
@@ -338,6 +454,9 @@ void MainWidget::refreshTimerStatus()
 
 void MainWidget::shouldRefreshTimerStatus(bool isRunning, QString name)
 {
+    if (!isPageLive()) {
+        return;
+    }
     QTWEPage->runJavaScript("typeof(angular) !== 'undefined' && "
                             "angular.element(document.body).injector().get('TimerService').timer.isTimerRunning == " + QString::number(isRunning)
                             ,
@@ -349,44 +468,41 @@ void MainWidget::shouldRefreshTimerStatus(bool isRunning, QString name)
                             });
 }
 
-void MainWidget::checkIsTimerRunning()
+void MainWidget::recentTasksPushed(const QByteArray &recentTasksJson)
 {
-    QTWEPage->runJavaScript("typeof(angular) !== 'undefined' && JSON.stringify(angular.element(document.body).injector().get('TimerService').timer)",
-        [this](const QVariant &v)
-    {
-        emit updateTimerStatus(v.toByteArray());
-    });
+    QJsonDocument itemDoc = QJsonDocument::fromJson(recentTasksJson);
+    if (itemDoc != LastTasksCache) {
+        applyRecentTasks(itemDoc);
+        settings.setValue(SETT_RECENT_TASKS, recentTasksJson); // for the tray while there's no page
+        emit lastTasksChanged();
+    }
 }
 
-void MainWidget::fetchRecentTasks()
+void MainWidget::applyRecentTasks(const QJsonDocument &recentTasks)
 {
-    QTWEPage->runJavaScript("typeof(TC) !== 'undefined' && JSON.stringify(TC.TimeTracking.Lasts)", [this](const QVariant &v)
-    {
-//        LastTasks.clear(); // don't need to clear a QHash
-
-//        qDebug() << v.toString();
-        QJsonDocument itemDoc = QJsonDocument::fromJson(v.toByteArray());
-        if (itemDoc != LastTasksCache) {
-            QJsonArray rootArray = itemDoc.array();
-            for (QJsonValueRef val: rootArray) {
-                QJsonObject obj = val.toObject();
-//            qDebug() << obj.value("task_id").toString().toInt() << ": " << obj.value("name").toString();
-                LastTasks.insert(obj.value("name").toString(), obj.value("task_id").toString().toInt());
-            }
-            LastTasksCache = itemDoc;
-            emit lastTasksChanged();
-        }
-    });
+//    LastTasks.clear(); // don't need to clear a QHash
+    QJsonArray rootArray = recentTasks.array();
+    for (QJsonValueRef val: rootArray) {
+        QJsonObject obj = val.toObject();
+//        qDebug() << obj.value("task_id").toString().toInt() << ": " << obj.value("name").toString();
+        LastTasks.insert(obj.value("name").toString(), obj.value("task_id").toString().toInt());
+    }
+    LastTasksCache = recentTasks;
 }
 
-void MainWidget::fetchAPIkey()
+void MainWidget::tokenPushed(const QString &token)
 {
-//    QTWEPage->runJavaScript("await window.apiService.getToken()",
-    QTWEPage->runJavaScript("typeof(window.apiService) !== 'undefined' && window.apiService.getToken().$$state.value", [this](const QVariant &v)
-    {
-//        qDebug() << "API Key: " << v.toString();
-        setApiKey(v.toString());
-    });
+    if (token.isEmpty()) {
+        return;
+    }
+    if (!loggedIn) {
+        // the page pushes a token only once, and the title may not have caught up yet; webpageTitleChanged applies it
+        pendingToken = token;
+        return;
+    }
+    if (token != settings.value(SETT_APIKEY).toString()) {
+        setApiKey(token);
+    }
 }
 
 
@@ -16,11 +16,14 @@
 #include <QMessageBox>
 #include <QSettings>
 #include <QJsonDocument>
+#include <QTimer>
 
 #include "Overrides/TCRequestInterceptor.h"
 #include "Overrides/TCWebEngineView.h"
 #include "Task.h"
 
+class PageBridge;
+
 namespace Ui
 {
     class MainWidget;
@@ -72,36 +75,49 @@ public slots:
     void goToAwayPage();
     void refreshTimerStatus();
     void shouldRefreshTimerStatus(bool, QString);
+    void windowVisibilityChanged(bool visible);
 
 private:
     Ui::MainWidget *ui;
     QSettings settings;
 
-    TCRequestInterceptor *TCri;
+    // all null until the webview is set up, which is after startup or when it's first needed
+    TCRequestInterceptor *TCri = nullptr;
 
-    TCWebEngineView *QTWEView;
-    QWebEngineProfile *QTWEProfile;
-    QWebEnginePage *QTWEPage;
-    QWebEngineSettings *QTWESettings;
+    TCWebEngineView *QTWEView = nullptr;
+    QWebEngineProfile *QTWEProfile = nullptr;
+    QWebEnginePage *QTWEPage = nullptr;
+    QWebEngineSettings *QTWESettings = nullptr;
 
     void runJSinPage(QString js);
     void forceLoadUrl(QString url);
     void showTaskPicker();
-    void checkIsTimerRunning();
-    void fetchRecentTasks();
-    void fetchAPIkey();
+    void recentTasksPushed(const QByteArray &recentTasksJson);
+    void tokenPushed(const QString &token);
     bool checkIfOnTimerPage();
     void goToTimerPage();
     void refreshTimerPageData();
 
     void checkIfLoggedIn(QString title);
     void setupWebview();
+    void ensureWebview();
+    // page lifecycle while the window is hidden: frozen after a minute, then closed (with its Chromium renderer)
+    void freezeWebview();
+    void releaseWebview();
+    bool isPageLive() const;
+    void applyRecentTasks(const QJsonDocument &recentTasks);
+
+    PageBridge *pageBridge = nullptr;
+    QTimer freezeTimer;
+    QTimer releaseTimer;
+    bool pageFrozen = false;
 
-    QShortcut *refreshBind;
-    QShortcut *fullscreenBind;
+    QShortcut *refreshBind = nullptr;
+    QShortcut *fullscreenBind = nullptr;
 
     bool MainWidgetWasInitialised = false;
     bool loggedIn;
+    QString pendingToken; // pushed by the page while loggedIn was still false
 
     void setApiKey(const QString &apiKey);
 };
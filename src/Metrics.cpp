@@ -0,0 +1,290 @@
+#include "Metrics.h"
+
+#include <cmath>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtAlgorithms>
+
+// values below this get a bucket each; above it, every power of two gets this many buckets
+static const int LINEAR_BUCKETS = 16;
+static const int SUB_BUCKET_BITS = 4;
+
+static int shardIndex()
+{
+    static std::atomic<int> nextShard{0};
+    static thread_local int shard = nextShard.fetch_add(1, std::memory_order_relaxed) % METRICS_SHARDS;
+    return shard;
+}
+
+void MetricCounter::add(quint64 amount)
+{
+    shards[shardIndex()].value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+quint64 MetricCounter::value() const
+{
+    quint64 sum = 0;
+    for (const Shard &shard : shards) {
+        sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void MetricGauge::set(qint64 newValue)
+{
+    currentValue.store(newValue, std::memory_order_relaxed);
+}
+
+void MetricGauge::add(qint64 amount)
+{
+    currentValue.fetch_add(amount, std::memory_order_relaxed);
+}
+
+qint64 MetricGauge::value() const
+{
+    return currentValue.load(std::memory_order_relaxed);
+}
+
+MetricHistogram::MetricHistogram()
+{
+    for (std::atomic<quint64> &bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+int MetricHistogram::bucketOf(quint64 value)
+{
+    if (value < LINEAR_BUCKETS) {
+        return static_cast<int>(value);
+    }
+    int magnitude = 63 - static_cast<int>(qCountLeadingZeroBits(value)); // >= SUB_BUCKET_BITS
+    int shift = magnitude - SUB_BUCKET_BITS;
+    int subBucket = static_cast<int>(value >> shift) - LINEAR_BUCKETS;
+    return LINEAR_BUCKETS + shift * LINEAR_BUCKETS + subBucket;
+}
+
+quint64 MetricHistogram::bucketUpperBound(int bucket)
+{
+    if (bucket < LINEAR_BUCKETS) {
+        return static_cast<quint64>(bucket);
+    }
+    int shift = (bucket - LINEAR_BUCKETS) / LINEAR_BUCKETS;
+    int subBucket = (bucket - LINEAR_BUCKETS) % LINEAR_BUCKETS;
+    quint64 lower = static_cast<quint64>(LINEAR_BUCKETS + subBucket) << shift;
+    return lower + ((quint64(1) << shift) - 1);
+}
+
+void MetricHistogram::record(quint64 value)
+{
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(value, std::memory_order_relaxed);
+    quint64 previousMax = maxValue.load(std::memory_order_relaxed);
+    while (value > previousMax && !maxValue.compare_exchange_weak(previousMax, value, std::memory_order_relaxed)) {
+    }
+}
+
+quint64 MetricHistogram::count() const
+{
+    quint64 sum = 0;
+    for (const std::atomic<quint64> &bucket : buckets) {
+        sum += bucket.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+quint64 MetricHistogram::sum() const
+{
+    return total.load(std::memory_order_relaxed);
+}
+
+quint64 MetricHistogram::max() const
+{
+    return maxValue.load(std::memory_order_relaxed);
+}
+
+QVector<quint64> MetricHistogram::bucketCounts() const
+{
+    QVector<quint64> counts(BucketCount);
+    for (int i = 0; i < BucketCount; i++) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+quint64 MetricHistogram::percentile(double fraction) const
+{
+    return percentileOf(bucketCounts(), fraction, max());
+}
+
+quint64 MetricHistogram::percentileOf(const QVector<quint64> &counts, double fraction, quint64 max)
+{
+    quint64 recorded = 0;
+    for (quint64 count : counts) {
+        recorded += count;
+    }
+    if (recorded == 0) {
+        return 0;
+    }
+
+    auto rank = qMax<quint64>(static_cast<quint64>(std::ceil(qBound(0.0, fraction, 1.0) * recorded)), 1);
+    quint64 seen = 0;
+    for (int i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return qMin(bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+MetricTimer::MetricTimer(MetricHistogram &histogram)
+    : histogram(histogram)
+{
+    timer.start();
+}
+
+MetricTimer::~MetricTimer()
+{
+    histogram.record(static_cast<quint64>(timer.nsecsElapsed() / 1000));
+}
+
+Metrics &Metrics::instance()
+{
+    static Metrics *_instance = new Metrics; // never destroyed, the logger counts messages until the very end
+    return *_instance;
+}
+
+const QVector<quint64> &Metrics::reportedBounds()
+{
+    static const QVector<quint64> bounds{
+        100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+    };
+    return bounds;
+}
+
+MetricCounter &Metrics::counter(const char *name, const char *help)
+{
+    QMutexLocker locker(&mutex);
+    Entry<MetricCounter> &entry = counters[QString::fromLatin1(name)];
+    if (!entry.metric) {
+        entry.help = QString::fromLatin1(help);
+        entry.metric.reset(new MetricCounter);
+    }
+    return *entry.metric;
+}
+
+MetricGauge &Metrics::gauge(const char *name, const char *help)
+{
+    QMutexLocker locker(&mutex);
+    Entry<MetricGauge> &entry = gauges[QString::fromLatin1(name)];
+    if (!entry.metric) {
+        entry.help = QString::fromLatin1(help);
+        entry.metric.reset(new MetricGauge);
+    }
+    return *entry.metric;
+}
+
+MetricHistogram &Metrics::histogram(const char *name, const char *help)
+{
+    QMutexLocker locker(&mutex);
+    Entry<MetricHistogram> &entry = histograms[QString::fromLatin1(name)];
+    if (!entry.metric) {
+        entry.help = QString::fromLatin1(help);
+        entry.metric.reset(new MetricHistogram);
+    }
+    return *entry.metric;
+}
+
+Metrics::Snapshot Metrics::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.takenAtMs = QDateTime::currentMSecsSinceEpoch();
+
+    QMutexLocker locker(&mutex);
+    for (const auto &entry : counters) {
+        snapshot.counters.append({entry.first, entry.second.help, static_cast<qint64>(entry.second.metric->value())});
+    }
+    for (const auto &entry : gauges) {
+        snapshot.gauges.append({entry.first, entry.second.help, entry.second.metric->value()});
+    }
+    for (const auto &entry : histograms) {
+        const MetricHistogram &histogram = *entry.second.metric;
+        QVector<quint64> counts = histogram.bucketCounts(); // every figure comes from this copy, so they agree
+        Distribution distribution;
+        distribution.name = entry.first;
+        distribution.help = entry.second.help;
+        distribution.sum = histogram.sum();
+        distribution.max = histogram.max();
+        distribution.p50 = MetricHistogram::percentileOf(counts, 0.5, distribution.max);
+        distribution.p90 = MetricHistogram::percentileOf(counts, 0.9, distribution.max);
+        distribution.p99 = MetricHistogram::percentileOf(counts, 0.99, distribution.max);
+        distribution.p999 = MetricHistogram::percentileOf(counts, 0.999, distribution.max);
+
+        // a bucket counts towards a bound when all of it is below the bound, so within the bucket precision
+        distribution.cumulative.fill(0, reportedBounds().size());
+        for (int bucket = 0; bucket < counts.size(); bucket++) {
+            distribution.count += counts[bucket];
+            quint64 upper = MetricHistogram::bucketUpperBound(bucket);
+            for (int bound = 0; bound < reportedBounds().size(); bound++) {
+                if (upper <= reportedBounds()[bound]) {
+                    distribution.cumulative[bound] += counts[bucket];
+                }
+            }
+        }
+        snapshot.histograms.append(distribution);
+    }
+    return snapshot;
+}
+
+QJsonObject Metrics::toJson(const Snapshot &snapshot)
+{
+    QJsonObject counterValues;
+    for (const Value &counter : snapshot.counters) {
+        counterValues.insert(counter.name, counter.value);
+    }
+    QJsonObject gaugeValues;
+    for (const Value &gauge : snapshot.gauges) {
+        gaugeValues.insert(gauge.name, gauge.value);
+    }
+    QJsonObject distributions;
+    for (const Distribution &distribution : snapshot.histograms) {
+        QJsonObject values;
+        values.insert("count", static_cast<qint64>(distribution.count));
+        values.insert("sum", static_cast<qint64>(distribution.sum));
+        values.insert("mean", distribution.count > 0 ? static_cast<double>(distribution.sum) / distribution.count : 0.0);
+        values.insert("max", static_cast<qint64>(distribution.max));
+        values.insert("p50", static_cast<qint64>(distribution.p50));
+        values.insert("p90", static_cast<qint64>(distribution.p90));
+        values.insert("p99", static_cast<qint64>(distribution.p99));
+        values.insert("p999", static_cast<qint64>(distribution.p999));
+        distributions.insert(distribution.name, values);
+    }
+
+    QJsonObject root;
+    root.insert("time", QDateTime::fromMSecsSinceEpoch(snapshot.takenAtMs, Qt::UTC).toString(Qt::ISODateWithMs));
+    root.insert("counters", counterValues);
+    root.insert("gauges", gaugeValues);
+    root.insert("histograms_us", distributions);
+    return root;
+}
+
+bool Metrics::exportTo(const QString &path) const
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(toJson(snapshot())).toJson());
+    return file.commit();
+}
+
+QString Metrics::exportFolder()
+{
+    return QStandardPaths::standardLocations(QStandardPaths::AppLocalDataLocation).first() + "/diagnostics";
+}
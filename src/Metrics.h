@@ -0,0 +1,185 @@
+#ifndef TIMECAMPDESKTOP_METRICS_H
+#define TIMECAMPDESKTOP_METRICS_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// counters are split over this many slots, threads are spread over them
+#define METRICS_SHARDS 16
+
+/**
+ * @brief A count that only goes up; cheap to bump from many threads at once
+ *
+ * Every thread adds to its own slot (on its own cache line), value() sums them up.
+ */
+class MetricCounter
+{
+    Q_DISABLE_COPY(MetricCounter)
+
+public:
+    MetricCounter() = default;
+
+    void add(quint64 amount = 1);
+    quint64 value() const;
+
+private:
+    struct Shard
+    {
+        std::atomic<quint64> value{0};
+        char padding[64 - sizeof(std::atomic<quint64>)];
+    };
+    Shard shards[METRICS_SHARDS];
+};
+
+/**
+ * @brief A value that goes up and down, like a queue length
+ */
+class MetricGauge
+{
+    Q_DISABLE_COPY(MetricGauge)
+
+public:
+    MetricGauge() = default;
+
+    void set(qint64 newValue);
+    void add(qint64 amount);
+    qint64 value() const;
+
+private:
+    std::atomic<qint64> currentValue{0};
+};
+
+/**
+ * @brief Distribution of a value (usually a duration in microseconds), HDR histogram style
+ *
+ * Values below 16 get a bucket each; above that, every power of two is split into 16 buckets,
+ * so any recorded value is known within 1/16 (6%) of itself, from 1 us to days, in a fixed 976 buckets.
+ * record() is a few relaxed atomic increments and never allocates.
+ */
+class MetricHistogram
+{
+    Q_DISABLE_COPY(MetricHistogram)
+
+public:
+    static const int BucketCount = 976;
+
+    MetricHistogram();
+
+    void record(quint64 value);
+    quint64 count() const;
+    quint64 sum() const;
+    quint64 max() const;
+    // the value below which the given fraction (0..1) of recorded values are, within the bucket precision
+    quint64 percentile(double fraction) const;
+    // a copy of all BucketCount bucket counts, so several figures can be worked out from the same moment
+    QVector<quint64> bucketCounts() const;
+
+    static int bucketOf(quint64 value);
+    static quint64 bucketUpperBound(int bucket);
+    static quint64 percentileOf(const QVector<quint64> &counts, double fraction, quint64 max);
+
+private:
+    std::atomic<quint64> buckets[BucketCount];
+    std::atomic<quint64> total{0};
+    std::atomic<quint64> maxValue{0};
+};
+
+/**
+ * @brief Records the time from its construction to its destruction in a histogram, in microseconds
+ */
+class MetricTimer
+{
+    Q_DISABLE_COPY(MetricTimer)
+
+public:
+    explicit MetricTimer(MetricHistogram &histogram);
+    ~MetricTimer();
+
+private:
+    MetricHistogram &histogram;
+    QElapsedTimer timer;
+};
+
+/**
+ * @brief Every counter, gauge and histogram of the app, by name
+ *
+ * Metrics are created on first use and live until exit, so call sites keep the reference in a static:
+ *   static MetricCounter &saved = Metrics::instance().counter("db_saved_activities_total", "Activities saved to the DB");
+ *   saved.add();
+ * snapshot() can be taken from any thread while metrics are updated.
+ */
+class Metrics
+{
+    Q_DISABLE_COPY(Metrics)
+
+public:
+    struct Value
+    {
+        QString name;
+        QString help;
+        qint64 value = 0;
+    };
+
+    struct Distribution
+    {
+        QString name;
+        QString help;
+        quint64 count = 0;
+        quint64 sum = 0;
+        quint64 max = 0;
+        quint64 p50 = 0;
+        quint64 p90 = 0;
+        quint64 p99 = 0;
+        quint64 p999 = 0;
+        QVector<quint64> cumulative; // how many values were at most each of reportedBounds()
+    };
+
+    struct Snapshot
+    {
+        qint64 takenAtMs = 0;
+        QVector<Value> counters;
+        QVector<Value> gauges;
+        QVector<Distribution> histograms;
+    };
+
+    static Metrics &instance();
+
+    // fixed histogram bucket bounds for exports that want buckets (OpenMetrics), 100 us to 10 s
+    static const QVector<quint64> &reportedBounds();
+
+    MetricCounter &counter(const char *name, const char *help);
+    MetricGauge &gauge(const char *name, const char *help);
+    MetricHistogram &histogram(const char *name, const char *help);
+
+    Snapshot snapshot() const;
+    static QJsonObject toJson(const Snapshot &snapshot);
+
+    // writes the current snapshot as JSON, replacing the file only when the whole of it is written
+    bool exportTo(const QString &path) const;
+    // where exports go: <app data>/diagnostics
+    static QString exportFolder();
+
+private:
+    Metrics() = default;
+
+    template<typename Metric>
+    struct Entry
+    {
+        QString help;
+        std::unique_ptr<Metric> metric;
+    };
+
+    mutable QMutex mutex; // guards the maps, not the metrics
+    std::map<QString, Entry<MetricCounter>> counters;
+    std::map<QString, Entry<MetricGauge>> gauges;
+    std::map<QString, Entry<MetricHistogram>> histograms;
+};
+
+#endif //TIMECAMPDESKTOP_METRICS_H
@@ -0,0 +1,234 @@
+#include "MetricsServer.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <Psapi.h>
+#elif defined(Q_OS_MACOS)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+// a scraper that hasn't sent its request by then is dropped
+static const int REQUEST_TIMEOUT_MS = 5 * 1000;
+// the request line and headers of a scrape are a few hundred bytes; anything bigger isn't one
+static const int MAX_REQUEST_BYTES = 8 * 1024;
+static const int MAX_CONNECTIONS = 8;
+// scrapes within this long of each other get the same page, so scraping in a loop costs one render per second
+static const int PAGE_CACHE_MS = 1000;
+
+static const char OPENMETRICS_CONTENT_TYPE[] = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+static qint64 residentMemoryBytes()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<qint64>(counters.WorkingSetSize);
+    }
+    return 0;
+#elif defined(Q_OS_MACOS)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+        return static_cast<qint64>(info.resident_size);
+    }
+    return 0;
+#else
+    // "size resident shared ..." in pages
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields[1].toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+static QByteArray escapeHelp(const QString &help)
+{
+    QByteArray escaped = help.toUtf8();
+    escaped.replace('\\', "\\\\");
+    escaped.replace('\n', "\\n");
+    return escaped;
+}
+
+static QByteArray familyHeader(const QByteArray &family, const char *type, const QString &help)
+{
+    return "# TYPE " + family + " " + type + "\n# HELP " + family + " " + escapeHelp(help) + "\n";
+}
+
+static QByteArray number(double value)
+{
+    return QByteArray::number(value, 'g', 15);
+}
+
+MetricsServer &MetricsServer::instance()
+{
+    static MetricsServer _instance;
+    return _instance;
+}
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject(parent)
+{
+    serverThread.setObjectName("MetricsServer");
+    moveToThread(&serverThread);
+    connect(&serverThread, &QThread::finished, this, &MetricsServer::close, Qt::DirectConnection);
+    serverThread.start(QThread::LowPriority);
+}
+
+MetricsServer::~MetricsServer()
+{
+    serverThread.quit();
+    serverThread.wait();
+}
+
+void MetricsServer::start(quint16 port)
+{
+    QTimer::singleShot(0, this, [this, port] { listen(port); }); // runs on serverThread, where this lives
+}
+
+void MetricsServer::listen(quint16 port)
+{
+    close();
+    server = new QTcpServer(this);
+    connect(server, &QTcpServer::newConnection, this, &MetricsServer::acceptConnections);
+    // loopback only: the numbers say what the user is doing and when, they don't leave the machine
+    if (!server->listen(QHostAddress::LocalHost, port)) {
+        qWarning() << "[MetricsServer] Can't listen on port" << port << server->errorString();
+        close();
+        return;
+    }
+    qInfo() << "[MetricsServer] Serving metrics on http://127.0.0.1:" << port << "/metrics";
+}
+
+void MetricsServer::close()
+{
+    // runs on the server thread, also right before it ends
+    delete server; // and with it, any connection still open
+    server = nullptr;
+    cachedPage.clear();
+}
+
+void MetricsServer::acceptConnections()
+{
+    while (server && server->hasPendingConnections()) {
+        QTcpSocket *socket = server->nextPendingConnection();
+        if (openConnections >= MAX_CONNECTIONS) {
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        openConnections++;
+        connect(socket, &QObject::destroyed, this, [this] { openConnections--; });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket] { readRequest(socket); });
+        QTimer::singleShot(REQUEST_TIMEOUT_MS, socket, [socket]
+        {
+            socket->abort();
+            socket->deleteLater();
+        });
+    }
+}
+
+void MetricsServer::readRequest(QTcpSocket *socket)
+{
+    if (socket->property("answered").toBool()) {
+        return; // one request per connection
+    }
+    QByteArray head = socket->peek(MAX_REQUEST_BYTES);
+    if (head.indexOf("\r\n\r\n") < 0) {
+        if (head.size() >= MAX_REQUEST_BYTES) {
+            reply(socket, "431 Request Header Fields Too Large", "text/plain; charset=utf-8", "Request too large\n");
+        }
+        return; // wait for the rest of the headers
+    }
+
+    QList<QByteArray> requestLine = head.left(head.indexOf("\r\n")).split(' ');
+    QByteArray method = requestLine.value(0);
+    QByteArray path = requestLine.value(1);
+    path = path.left(path.indexOf('?') >= 0 ? path.indexOf('?') : path.size());
+
+    if (path != "/metrics") {
+        reply(socket, "404 Not Found", "text/plain; charset=utf-8", "Metrics are at /metrics\n");
+    } else if (method != "GET") {
+        reply(socket, "405 Method Not Allowed", "text/plain; charset=utf-8", "Only GET is supported\n");
+    } else {
+        reply(socket, "200 OK", OPENMETRICS_CONTENT_TYPE, metricsPage());
+    }
+}
+
+void MetricsServer::reply(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body)
+{
+    socket->setProperty("answered", true);
+    QByteArray head = "HTTP/1.1 " + status + "\r\n"
+        "Content-Type: " + contentType + "\r\n"
+        "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+        "Connection: close\r\n"
+        "\r\n";
+    socket->write(head);
+    socket->write(body);
+    socket->disconnectFromHost(); // after what's written is sent
+}
+
+QByteArray MetricsServer::metricsPage()
+{
+    if (!cachedPage.isEmpty() && cachedPageAge.elapsed() < PAGE_CACHE_MS) {
+        return cachedPage;
+    }
+    static MetricGauge &memory = Metrics::instance().gauge("process_resident_memory_bytes", "Resident memory of the app, in bytes");
+    memory.set(residentMemoryBytes());
+
+    cachedPage = renderOpenMetrics(Metrics::instance().snapshot());
+    cachedPageAge.start();
+    return cachedPage;
+}
+
+QByteArray MetricsServer::renderOpenMetrics(const Metrics::Snapshot &snapshot)
+{
+    QByteArray page;
+    for (const Metrics::Value &counter : snapshot.counters) {
+        // the family is named without the _total suffix, its sample with it
+        QByteArray family = counter.name.toUtf8();
+        if (family.endsWith("_total")) {
+            family.chop(6);
+        }
+        page += familyHeader(family, "counter", counter.help);
+        page += family + "_total " + QByteArray::number(counter.value) + "\n";
+    }
+    for (const Metrics::Value &gauge : snapshot.gauges) {
+        QByteArray family = gauge.name.toUtf8();
+        page += familyHeader(family, "gauge", gauge.help);
+        page += family + " " + QByteArray::number(gauge.value) + "\n";
+    }
+    for (const Metrics::Distribution &distribution : snapshot.histograms) {
+        // histograms are kept in microseconds; Prometheus wants base units
+        QByteArray family = distribution.name.toUtf8();
+        double scale = 1.0;
+        if (family.endsWith("_us")) {
+            family.chop(3);
+            family += "_seconds";
+            scale = 1e-6;
+        }
+        page += familyHeader(family, "histogram", distribution.help);
+        const QVector<quint64> &bounds = Metrics::reportedBounds();
+        for (int i = 0; i < bounds.size() && i < distribution.cumulative.size(); i++) {
+            page += family + "_bucket{le=\"" + number(bounds[i] * scale) + "\"} "
+                + QByteArray::number(distribution.cumulative[i]) + "\n";
+        }
+        page += family + "_bucket{le=\"+Inf\"} " + QByteArray::number(distribution.count) + "\n";
+        page += family + "_sum " + number(distribution.sum * scale) + "\n";
+        page += family + "_count " + QByteArray::number(distribution.count) + "\n";
+    }
+    page += "# EOF\n";
+    return page;
+}
@@ -0,0 +1,54 @@
+#ifndef TIMECAMPDESKTOP_METRICSSERVER_H
+#define TIMECAMPDESKTOP_METRICSSERVER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QThread>
+
+#include "Metrics.h"
+
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * @brief Serves Metrics in OpenMetrics (Prometheus) text format on http://127.0.0.1:<port>/metrics
+ *
+ * Opt-in through SETT_METRICS_ENDPOINT. Listens on the loopback interface only and runs on its own thread,
+ * so a scrape never waits for the GUI thread. To keep scrapes cheap, the rendered page is reused for a second
+ * and only a few connections are served at a time; anything slow or malformed is dropped.
+ */
+class MetricsServer : public QObject
+{
+Q_OBJECT
+    Q_DISABLE_COPY(MetricsServer)
+
+public:
+    static MetricsServer &instance();
+    ~MetricsServer() override;
+
+    // can be called from any thread; listens from the server thread
+    void start(quint16 port);
+
+    static QByteArray renderOpenMetrics(const Metrics::Snapshot &snapshot);
+
+private:
+    explicit MetricsServer(QObject *parent = nullptr);
+
+    void listen(quint16 port);
+    void close();
+    void acceptConnections();
+    void readRequest(QTcpSocket *socket);
+    void reply(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body);
+    QByteArray metricsPage();
+
+    QThread serverThread;
+
+    // only used on the server thread
+    QTcpServer *server = nullptr;
+    int openConnections = 0;
+    QByteArray cachedPage;
+    QElapsedTimer cachedPageAge;
+};
+
+#endif //TIMECAMPDESKTOP_METRICSSERVER_H
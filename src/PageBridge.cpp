@@ -0,0 +1,62 @@
+#include "PageBridge.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QWebChannel>
+#include <QWebEnginePage>
+#include <QWebEngineScript>
+#include <QWebEngineScriptCollection>
+
+#include "LogCategories.h"
+#include "Settings.h"
+#include "Tracing.h"
+
+static QString readResource(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "[PageBridge] Can't read" << path;
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll());
+}
+
+PageBridge::PageBridge(QObject *parent)
+    : QObject(parent), channel(new QWebChannel(this))
+{
+    channel->registerObject(QStringLiteral("timecamp"), this);
+}
+
+void PageBridge::attachTo(QWebEnginePage *page)
+{
+    page->setWebChannel(channel);
+
+    // qwebchannel.js comes with Qt WebChannel; our script needs it, and the web app's globals, so both run in the main world
+    QWebEngineScript script;
+    script.setName(QStringLiteral("TimeCampPageBridge"));
+    script.setSourceCode(readResource(":/qtwebchannel/qwebchannel.js") + "\n" + readResource(":/Scripts/PageBridge.js"));
+    script.setInjectionPoint(QWebEngineScript::DocumentReady);
+    script.setWorldId(QWebEngineScript::MainWorld);
+    script.setRunsOnSubFrames(false);
+    page->scripts().insert(script);
+}
+
+void PageBridge::pushTimer(const QString &timerJson)
+{
+    TRACE_SCOPE("PageBridge::pushTimer");
+    qCDebug(lcWebView) << "Timer pushed: " << timerJson.left(MAX_LOG_TEXT_LENGTH);
+    emit timerChanged(timerJson.toUtf8());
+}
+
+void PageBridge::pushRecentTasks(const QString &recentTasksJson)
+{
+    TRACE_SCOPE("PageBridge::pushRecentTasks");
+    qCDebug(lcWebView) << "Recent tasks pushed: " << recentTasksJson.left(MAX_LOG_TEXT_LENGTH);
+    emit recentTasksChanged(recentTasksJson.toUtf8());
+}
+
+void PageBridge::pushToken(const QString &token)
+{
+    TRACE_SCOPE("PageBridge::pushToken");
+    emit tokenChanged(token);
+}
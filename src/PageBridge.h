@@ -0,0 +1,43 @@
+#ifndef TIMECAMPDESKTOP_PAGEBRIDGE_H
+#define TIMECAMPDESKTOP_PAGEBRIDGE_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+class QWebChannel;
+class QWebEnginePage;
+
+/**
+ * @brief What the web app tells us about itself, pushed from the page when it changes
+ *
+ * attachTo() publishes this object to the page as "timecamp" over a QWebChannel and injects res/PageBridge.js
+ * into every document. The script watches the Angular timer, TC.TimeTracking.Lasts and the API token
+ * ($rootScope.$watch, so only when a digest changed them) and calls the slots below; nothing is polled.
+ */
+class PageBridge : public QObject
+{
+Q_OBJECT
+    Q_DISABLE_COPY(PageBridge)
+
+public:
+    explicit PageBridge(QObject *parent = nullptr);
+
+    void attachTo(QWebEnginePage *page);
+
+signals:
+    void timerChanged(QByteArray timerJson);
+    void recentTasksChanged(QByteArray recentTasksJson);
+    void tokenChanged(QString token);
+
+public slots:
+    // called from the page; JSON as JSON.stringify() made it
+    void pushTimer(const QString &timerJson);
+    void pushRecentTasks(const QString &recentTasksJson);
+    void pushToken(const QString &token);
+
+private:
+    QWebChannel *channel;
+};
+
+#endif //TIMECAMPDESKTOP_PAGEBRIDGE_H
@@ -0,0 +1,43 @@
+#ifndef TIMECAMPDESKTOP_PARALLELCHUNKS_H
+#define TIMECAMPDESKTOP_PARALLELCHUNKS_H
+
+#include <QFuture>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace ParallelChunks
+{
+    /**
+     * Splits [0, count) into chunks of at least minChunkSize items, runs work(begin, end) on the global thread pool
+     * for each of them and returns the results in chunk order. There are a few chunks per thread, so
+     * threads that finish early take the remaining ones, and the waiting thread runs chunks nobody started yet.
+     * Small inputs (a single chunk) run directly in the calling thread.
+     */
+    template<typename Result, typename Work>
+    QVector<Result> map(int count, int minChunkSize, Work work)
+    {
+        QVector<Result> results;
+        int maxChunks = qMax(1, QThread::idealThreadCount() * 4);
+        int chunkCount = qMin(maxChunks, count / qMax(1, minChunkSize));
+        if (chunkCount <= 1) {
+            results.append(work(0, count));
+            return results;
+        }
+
+        QVector<QFuture<Result>> futures;
+        futures.reserve(chunkCount);
+        for (int chunk = 0; chunk < chunkCount; chunk++) {
+            int begin = static_cast<int>(static_cast<qint64>(count) * chunk / chunkCount);
+            int end = static_cast<int>(static_cast<qint64>(count) * (chunk + 1) / chunkCount);
+            futures.append(QtConcurrent::run([&work, begin, end]() { return work(begin, end); }));
+        }
+        results.reserve(chunkCount);
+        for (QFuture<Result> &future : futures) {
+            results.append(future.result());
+        }
+        return results;
+    }
+}
+
+#endif //TIMECAMPDESKTOP_PARALLELCHUNKS_H
@@ -41,6 +41,22 @@
 #define SETT_LAST_SYNC "LAST_SYNC"
 #define SETT_WAS_WINDOW_LEFT_OPENED "WAS_WINDOW_LEFT_OPENED"
 #define SETT_IS_FIRST_RUN "IS_FIRST_RUN"
+#define SETT_BINARY_LOG "BINARY_LOG" // write Log_*.tclog instead of text logs, read at startup
+#define SETT_METRICS_ENDPOINT "METRICS_ENDPOINT" // serve metrics on http://127.0.0.1:<port>/metrics, read at startup
+#define SETT_METRICS_PORT "METRICS_PORT"
+#define DEFAULT_METRICS_PORT 9464
+#define SETT_TRACING "TRACING" // record trace spans for "Save diagnostics", read at startup
+#define SETT_WEBVIEW_RELEASE_MINUTES "WEBVIEW_RELEASE_MINUTES" // close QtWebEngine when hidden this long; 0 keeps it
+#define DEFAULT_WEBVIEW_RELEASE_MINUTES 10
+#define SETT_RECENT_TASKS "RECENT_TASKS" // TC.TimeTracking.Lasts as last seen in the page, for the tray without the page
+
+// web settings, saved by Comms::settingsReply with this prefix
+#define SETT_WEB_PREFIX "SETT_WEB_"
+#define SETT_WEB_IDLE_TIME SETT_WEB_PREFIX "idletime"
+#define SETT_WEB_LOG_OFFLINE SETT_WEB_PREFIX "logoffline"
+#define SETT_WEB_LOG_OFFLINE_MIN SETT_WEB_PREFIX "logofflinemin"
+#define SETT_WEB_DONT_COLLECT_COMPUTER_ACTIVITY SETT_WEB_PREFIX "dontCollectComputerActivity"
+#define SETT_WEB_COLLECT_WINDOW_TITLES SETT_WEB_PREFIX "collectWindowTitles"
 
 #define SETT_HIDDEN_COMPUTER_ACTIVITIES_CONST_NAME "computer activity"
 
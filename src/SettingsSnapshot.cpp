@@ -0,0 +1,72 @@
+#include "SettingsSnapshot.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSettings>
+
+#include "Settings.h"
+
+bool SettingsSnapshot::operator==(const SettingsSnapshot &other) const
+{
+    return autoTracking == other.autoTracking
+           && idleTimeMS == other.idleTimeMS
+           && awayPopupAfterMS == other.awayPopupAfterMS
+           && showAwayPopup == other.showAwayPopup
+           && collectComputerActivity == other.collectComputerActivity
+           && collectWindowTitles == other.collectWindowTitles;
+}
+
+bool SettingsSnapshot::operator!=(const SettingsSnapshot &other) const
+{
+    return !(*this == other);
+}
+
+SettingsService &SettingsService::instance()
+{
+    static SettingsService _instance;
+    return _instance;
+}
+
+SettingsService::SettingsService()
+    : snapshot(new SettingsSnapshot(readSettings()))
+{
+}
+
+SettingsService::~SettingsService()
+{
+    delete snapshot.loadAcquire();
+    qDeleteAll(retiredSnapshots);
+}
+
+const SettingsSnapshot &SettingsService::current() const
+{
+    return *snapshot.loadAcquire();
+}
+
+void SettingsService::reload()
+{
+    QMutexLocker locker(&reloadMutex);
+    SettingsSnapshot fresh = readSettings();
+    const SettingsSnapshot *previous = snapshot.loadAcquire();
+    if (fresh == *previous) {
+        return;
+    }
+    snapshot.storeRelease(new SettingsSnapshot(fresh));
+    retiredSnapshots.append(previous);
+
+    qDebug() << "[Settings] new snapshot: idle after" << fresh.idleTimeMS << "ms, auto tracking" << fresh.autoTracking
+             << ", collect activity" << fresh.collectComputerActivity << ", collect titles" << fresh.collectWindowTitles;
+}
+
+SettingsSnapshot SettingsService::readSettings()
+{
+    QSettings settings;
+    SettingsSnapshot values;
+    values.autoTracking = settings.value(SETT_TRACK_AUTO_SWITCH, false).toBool();
+    values.idleTimeMS = settings.value(SETT_WEB_IDLE_TIME).toUInt() * 60 * 1000;
+    values.awayPopupAfterMS = settings.value(SETT_WEB_LOG_OFFLINE_MIN).toUInt() * 60 * 1000;
+    values.showAwayPopup = settings.value(SETT_WEB_LOG_OFFLINE).toBool();
+    values.collectComputerActivity = !settings.value(SETT_WEB_DONT_COLLECT_COMPUTER_ACTIVITY).toBool();
+    values.collectWindowTitles = settings.value(SETT_WEB_COLLECT_WINDOW_TITLES).toBool();
+    return values;
+}
@@ -0,0 +1,55 @@
+#ifndef TIMECAMPDESKTOP_SETTINGSSNAPSHOT_H
+#define TIMECAMPDESKTOP_SETTINGSSNAPSHOT_H
+
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QVector>
+
+// the settings read on every activity or idle check, as plain values
+struct SettingsSnapshot
+{
+    bool autoTracking = false;
+
+    // from the web settings
+    unsigned int idleTimeMS = 0;
+    unsigned int awayPopupAfterMS = 0;
+    bool showAwayPopup = false;
+    bool collectComputerActivity = true;
+    bool collectWindowTitles = false;
+
+    bool operator==(const SettingsSnapshot &other) const;
+    bool operator!=(const SettingsSnapshot &other) const;
+};
+
+/**
+ * @brief Hands out the current SettingsSnapshot to any thread without locks
+ *
+ * QSettings takes a lock and may hit the registry or an INI file on every read; hot paths read
+ * current() instead, which is one atomic load. Whoever writes one of the snapshot's settings calls reload(),
+ * which reads them all and publishes a new snapshot if anything changed.
+ * Snapshots that were replaced are kept until exit, so a reference from current() never dangles;
+ * there are only as many as there were actual changes.
+ */
+class SettingsService
+{
+    Q_DISABLE_COPY(SettingsService)
+
+public:
+    static SettingsService &instance();
+    ~SettingsService();
+
+    const SettingsSnapshot &current() const;
+    void reload();
+
+protected:
+    SettingsService();
+
+private:
+    QAtomicPointer<const SettingsSnapshot> snapshot;
+    QMutex reloadMutex;
+    QVector<const SettingsSnapshot *> retiredSnapshots;
+
+    static SettingsSnapshot readSettings();
+};
+
+#endif //TIMECAMPDESKTOP_SETTINGSSNAPSHOT_H
@@ -0,0 +1,99 @@
+#include "StartupProfile.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QSaveFile>
+#include <QVector>
+
+#include "Metrics.h"
+#include "Tracing.h"
+
+namespace
+{
+    struct Phase
+    {
+        const char *name;
+        qint64 ms;
+    };
+
+    QMutex mutex; // guards everything below
+    QElapsedTimer sinceStart;
+    qint64 traceStartNs = 0;
+    QVector<Phase> phases; // in the order they were reached
+    QByteArray reportPhase;
+    QString reportPath;
+
+    // from whichever thread reached the phase; quit() is queued, so it also works before exec()
+    void writeReportAndQuit()
+    {
+        QString path;
+        {
+            QMutexLocker locker(&mutex);
+            path = reportPath;
+        }
+        QSaveFile file(path);
+        bool written = file.open(QIODevice::WriteOnly);
+        if (written) {
+            file.write(QJsonDocument(StartupProfile::toJson()).toJson());
+            written = file.commit();
+        }
+        if (!written) {
+            qWarning() << "[Startup] Can't write the startup profile to" << path << file.errorString();
+        }
+        QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+    }
+}
+
+void StartupProfile::begin()
+{
+    QMutexLocker locker(&mutex);
+    sinceStart.start();
+    traceStartNs = Tracing::now();
+}
+
+void StartupProfile::mark(const char *phase)
+{
+    QMutexLocker locker(&mutex);
+    if (!sinceStart.isValid()) {
+        return;
+    }
+    for (const Phase &reached : phases) {
+        if (qstrcmp(reached.name, phase) == 0) {
+            return;
+        }
+    }
+    qint64 ms = sinceStart.elapsed();
+    phases.append({phase, ms});
+    bool report = reportPhase == phase;
+    qint64 startNs = traceStartNs;
+    locker.unlock();
+
+    qInfo().noquote() << "[Startup]" << phase << "after" << ms << "ms";
+    QByteArray gaugeName = QByteArray("startup_") + phase + "_ms";
+    Metrics::instance().gauge(gaugeName.constData(), "Milliseconds from start to this startup phase").set(ms);
+    Tracing::record(phase, startNs, Tracing::now());
+
+    if (report) {
+        writeReportAndQuit();
+    }
+}
+
+QJsonObject StartupProfile::toJson()
+{
+    QMutexLocker locker(&mutex);
+    QJsonObject object;
+    for (const Phase &reached : phases) {
+        object.insert(QString::fromLatin1(reached.name), reached.ms);
+    }
+    return object;
+}
+
+void StartupProfile::reportAndQuitAt(const char *phase, const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    reportPhase = phase;
+    reportPath = path;
+}
@@ -0,0 +1,22 @@
+#ifndef TIMECAMPDESKTOP_STARTUPPROFILE_H
+#define TIMECAMPDESKTOP_STARTUPPROFILE_H
+
+#include <QJsonObject>
+#include <QString>
+
+// When each startup phase was reached, in ms since main() started: "tray" (the icon is up), "capture"
+// (the collector runs), "event_loop", "first_sync", "webview", "first_activity" (the first one captured)...
+// Every phase is logged once, kept as a startup_<phase>_ms gauge in Metrics and as a span in Tracing.
+namespace StartupProfile
+{
+    // call first thing in main()
+    void begin();
+    // the phase (a string literal) was reached now; later calls for the same phase are ignored; any thread
+    void mark(const char *phase);
+
+    QJsonObject toJson();
+    // once the phase is reached, writes toJson() to the file and quits the app; for measuring startup in CI
+    void reportAndQuitAt(const char *phase, const QString &path);
+}
+
+#endif //TIMECAMPDESKTOP_STARTUPPROFILE_H
@@ -0,0 +1,303 @@
+#include "StringKernels.h"
+
+#include <QVarLengthArray>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRINGKERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define STRINGKERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define STRINGKERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define STRINGKERNELS_TARGET_AVX2 // MSVC allows AVX2 intrinsics in any function
+#endif
+
+namespace
+{
+    struct Needle
+    {
+        const ushort *folded;
+        int length;
+        // what the first and last folded unit look like in ASCII text
+        ushort firstA, firstB, lastA, lastB;
+    };
+
+    inline ushort foldUnit(ushort unit)
+    {
+        if (unit < 0x80) {
+            return (unit >= 'A' && unit <= 'Z') ? static_cast<ushort>(unit + 32) : unit;
+        }
+        return static_cast<ushort>(QChar::toCaseFolded(static_cast<uint>(unit)));
+    }
+
+    inline void asciiCases(ushort folded, ushort &a, ushort &b)
+    {
+        if (folded >= 0x80) {
+            a = b = 0xFFFF; // only non-ASCII units fold to it, and those are always candidates
+        } else if (folded >= 'a' && folded <= 'z') {
+            a = folded;
+            b = static_cast<ushort>(folded - 32);
+        } else {
+            a = b = folded;
+        }
+    }
+
+    inline bool verify(const ushort *at, const Needle &needle)
+    {
+        for (int k = 0; k < needle.length; k++) {
+            if (foldUnit(at[k]) != needle.folded[k]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline bool isCandidate(ushort unit, ushort a, ushort b)
+    {
+        return unit == a || unit == b || unit >= 0x80;
+    }
+
+    int scalarSearch(const ushort *haystack, int from, int length, const Needle &needle)
+    {
+        const int last = needle.length - 1;
+        for (int i = from; i + needle.length <= length; i++) {
+            if (isCandidate(haystack[i], needle.firstA, needle.firstB)
+                && isCandidate(haystack[i + last], needle.lastA, needle.lastB)
+                && verify(haystack + i, needle)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    int scalarKernel(const ushort *haystack, int length, const Needle &needle)
+    {
+        return scalarSearch(haystack, 0, length, needle);
+    }
+
+    inline int countTrailingZeros(unsigned mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+#ifdef STRINGKERNELS_X86
+    // movemask gives 2 bits per 16-bit lane
+    inline int checkCandidateMask(unsigned mask, const ushort *block, const Needle &needle)
+    {
+        while (mask != 0) {
+            int bit = countTrailingZeros(mask);
+            if (verify(block + bit / 2, needle)) {
+                return bit / 2;
+            }
+            mask &= ~(3u << bit);
+        }
+        return -1;
+    }
+
+    inline __m128i candidates128(__m128i units, __m128i a, __m128i b)
+    {
+        __m128i nonAscii = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xFF80))), _mm_setzero_si128());
+        nonAscii = _mm_xor_si128(nonAscii, _mm_set1_epi16(-1));
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(units, a), _mm_cmpeq_epi16(units, b)), nonAscii);
+    }
+
+    int sse2Kernel(const ushort *haystack, int length, const Needle &needle)
+    {
+        const __m128i firstA = _mm_set1_epi16(static_cast<short>(needle.firstA));
+        const __m128i firstB = _mm_set1_epi16(static_cast<short>(needle.firstB));
+        const __m128i lastA = _mm_set1_epi16(static_cast<short>(needle.lastA));
+        const __m128i lastB = _mm_set1_epi16(static_cast<short>(needle.lastB));
+        const int last = needle.length - 1;
+
+        int i = 0;
+        for (; i + last + 8 <= length; i += 8) {
+            __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+            __m128i lastUnits = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + last));
+            __m128i both = _mm_and_si128(candidates128(first, firstA, firstB), candidates128(lastUnits, lastA, lastB));
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(both));
+            if (mask != 0) {
+                int lane = checkCandidateMask(mask, haystack + i, needle);
+                if (lane >= 0) {
+                    return i + lane;
+                }
+            }
+        }
+        return scalarSearch(haystack, i, length, needle);
+    }
+
+    STRINGKERNELS_TARGET_AVX2
+    inline __m256i candidates256(__m256i units, __m256i a, __m256i b)
+    {
+        __m256i nonAscii = _mm256_cmpeq_epi16(_mm256_and_si256(units, _mm256_set1_epi16(static_cast<short>(0xFF80))), _mm256_setzero_si256());
+        nonAscii = _mm256_xor_si256(nonAscii, _mm256_set1_epi16(-1));
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi16(units, a), _mm256_cmpeq_epi16(units, b)), nonAscii);
+    }
+
+    STRINGKERNELS_TARGET_AVX2
+    int avx2Kernel(const ushort *haystack, int length, const Needle &needle)
+    {
+        const __m256i firstA = _mm256_set1_epi16(static_cast<short>(needle.firstA));
+        const __m256i firstB = _mm256_set1_epi16(static_cast<short>(needle.firstB));
+        const __m256i lastA = _mm256_set1_epi16(static_cast<short>(needle.lastA));
+        const __m256i lastB = _mm256_set1_epi16(static_cast<short>(needle.lastB));
+        const int last = needle.length - 1;
+
+        int i = 0;
+        for (; i + last + 16 <= length; i += 16) {
+            __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+            __m256i lastUnits = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + last));
+            __m256i both = _mm256_and_si256(candidates256(first, firstA, firstB), candidates256(lastUnits, lastA, lastB));
+            auto mask = static_cast<unsigned>(_mm256_movemask_epi8(both));
+            if (mask != 0) {
+                int lane = checkCandidateMask(mask, haystack + i, needle);
+                if (lane >= 0) {
+                    return i + lane;
+                }
+            }
+        }
+        // titles are short, the rest usually fits one SSE2 block
+        int rest = sse2Kernel(haystack + i, length - i, needle);
+        return rest < 0 ? -1 : i + rest;
+    }
+
+    bool cpuHasAvx2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+        if (!osSavesYmm) {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif // STRINGKERNELS_X86
+
+#ifdef STRINGKERNELS_NEON
+    inline uint16x8_t candidatesNeon(uint16x8_t units, uint16x8_t a, uint16x8_t b)
+    {
+        uint16x8_t nonAscii = vtstq_u16(units, vdupq_n_u16(0xFF80));
+        return vorrq_u16(vorrq_u16(vceqq_u16(units, a), vceqq_u16(units, b)), nonAscii);
+    }
+
+    int neonKernel(const ushort *haystack, int length, const Needle &needle)
+    {
+        const uint16x8_t firstA = vdupq_n_u16(needle.firstA);
+        const uint16x8_t firstB = vdupq_n_u16(needle.firstB);
+        const uint16x8_t lastA = vdupq_n_u16(needle.lastA);
+        const uint16x8_t lastB = vdupq_n_u16(needle.lastB);
+        const int last = needle.length - 1;
+
+        int i = 0;
+        for (; i + last + 8 <= length; i += 8) {
+            uint16x8_t first = vld1q_u16(haystack + i);
+            uint16x8_t lastUnits = vld1q_u16(haystack + i + last);
+            uint16x8_t both = vandq_u16(candidatesNeon(first, firstA, firstB), candidatesNeon(lastUnits, lastA, lastB));
+            if (vmaxvq_u16(both) == 0) {
+                continue;
+            }
+            ushort lanes[8];
+            vst1q_u16(lanes, both);
+            for (int lane = 0; lane < 8; lane++) {
+                if (lanes[lane] != 0 && verify(haystack + i + lane, needle)) {
+                    return i + lane;
+                }
+            }
+        }
+        return scalarSearch(haystack, i, length, needle);
+    }
+#endif // STRINGKERNELS_NEON
+
+    using SearchKernel = int (*)(const ushort *haystack, int length, const Needle &needle);
+
+    struct Kernel
+    {
+        SearchKernel search;
+        const char *name;
+    };
+
+    Kernel selectKernel()
+    {
+#if defined(STRINGKERNELS_X86)
+        if (cpuHasAvx2()) {
+            return {avx2Kernel, "avx2"};
+        }
+        return {sse2Kernel, "sse2"};
+#elif defined(STRINGKERNELS_NEON)
+        return {neonKernel, "neon"};
+#endif
+        return {scalarKernel, "scalar"};
+    }
+
+    const Kernel &kernel()
+    {
+        static const Kernel selected = selectKernel();
+        return selected;
+    }
+}
+
+namespace StringKernels
+{
+    int indexOfCaseInsensitive(const QChar *haystack, int haystackLength, const QChar *needle, int needleLength)
+    {
+        if (needleLength == 0) {
+            return 0;
+        }
+        if (needleLength > haystackLength) {
+            return -1;
+        }
+
+        QVarLengthArray<ushort, 64> folded(needleLength);
+        for (int i = 0; i < needleLength; i++) {
+            folded[i] = foldUnit(needle[i].unicode());
+        }
+
+        Needle prepared{folded.constData(), needleLength, 0, 0, 0, 0};
+        asciiCases(folded[0], prepared.firstA, prepared.firstB);
+        asciiCases(folded[needleLength - 1], prepared.lastA, prepared.lastB);
+
+        return kernel().search(reinterpret_cast<const ushort *>(haystack), haystackLength, prepared);
+    }
+
+    int indexOfCaseInsensitive(const QString &haystack, const QString &needle)
+    {
+        return indexOfCaseInsensitive(haystack.constData(), haystack.size(), needle.constData(), needle.size());
+    }
+
+    bool containsCaseInsensitive(const QString &haystack, const QString &needle)
+    {
+        return indexOfCaseInsensitive(haystack, needle) >= 0;
+    }
+
+    bool containsAnyCaseInsensitive(const QString &haystack, const QStringList &needles)
+    {
+        for (const QString &needle : needles) {
+            if (indexOfCaseInsensitive(haystack, needle) >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char *kernelName()
+    {
+        return kernel().name;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef TIMECAMPDESKTOP_STRINGKERNELS_H
+#define TIMECAMPDESKTOP_STRINGKERNELS_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * Case-insensitive substring search over UTF-16, for window titles, process names and URLs.
+ *
+ * Candidates are found 8 or 16 code units at a time (SSE2 / AVX2 picked at runtime on x86, NEON on ARM64):
+ * positions where the first and last character of the needle could match. A position is a candidate
+ * when it holds either ASCII case of that character, or any non-ASCII unit (a few of them fold to ASCII,
+ * like the Kelvin sign), and every candidate is verified with the same per-unit case folding as
+ * QString::indexOf(..., Qt::CaseInsensitive). So mostly-ASCII text takes the fast path and the results match Qt's.
+ */
+namespace StringKernels
+{
+    int indexOfCaseInsensitive(const QChar *haystack, int haystackLength, const QChar *needle, int needleLength);
+    int indexOfCaseInsensitive(const QString &haystack, const QString &needle);
+
+    bool containsCaseInsensitive(const QString &haystack, const QString &needle);
+    // replacement for haystack.toLower().contains(QRegExp("a|b|c")) with plain-text alternatives
+    bool containsAnyCaseInsensitive(const QString &haystack, const QStringList &needles);
+
+    // which implementation this CPU got: "avx2", "sse2", "neon" or "scalar"
+    const char *kernelName();
+}
+
+#endif //TIMECAMPDESKTOP_STRINGKERNELS_H
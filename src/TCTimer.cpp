@@ -1,11 +1,17 @@
 #include "TCTimer.h"
 
+static const int TIMER_RECONCILE_INTERVAL_MS = 5 * 60 * 1000;
+
 TCTimer::TCTimer(Comms *comms)
     : comms(comms)
 {
     clearData();
 
-    lastStatusCheck = QDateTime::currentMSecsSinceEpoch();
+    tickTimer.setInterval(1000);
+    QObject::connect(&tickTimer, &QTimer::timeout, this, &TCTimer::emitElapsed);
+    reconcileTimer.setInterval(TIMER_RECONCILE_INTERVAL_MS);
+    QObject::connect(&reconcileTimer, &QTimer::timeout, this, &TCTimer::status);
+    reconcileTimer.start();
 
     // we can't be calling API if we don't have the key; try to set the key
     comms->updateApiKeyFromSettings();
@@ -44,11 +50,11 @@ void TCTimer::stop(qint64 timerID, qint64 stoppedAtInMS)
 
 void TCTimer::status()
 {
-    qint64 now = QDateTime::currentMSecsSinceEpoch();
-    if (lastStatusCheck - now < 1000) { // if called less than a second ago
+    if (sinceStatusCheck.isValid() && sinceStatusCheck.elapsed() < 1000) { // if called less than a second ago
         return;
     }
-    lastStatusCheck = now;
+    sinceStatusCheck.start();
+    reconcileTimer.start(); // the next one is a whole interval from now
     QUrlQuery params = comms->getApiParams();
     params.addQueryItem("action", "status");
     comms->postRequest(comms->getApiUrl("/timer", "json"), params);
@@ -65,56 +71,106 @@ void TCTimer::decideTimerReply(QNetworkReply *reply, QByteArray buffer)
 
 void TCTimer::timerStatusReply(QByteArray buffer)
 {
-    bool previousIsRunning = isRunning;
-    QString previousName = name;
     QJsonDocument itemDoc = QJsonDocument::fromJson(buffer);
 
     buffer.truncate(MAX_LOG_TEXT_LENGTH);
     qDebug() << "Timer Status Response: " << buffer;
 
-    QJsonObject rootObject = itemDoc.object();
-    QJsonValue isTimerRuninngJsonValue = rootObject.value("isTimerRunning");
-    isRunning = (isTimerRuninngJsonValue.isString() && (isTimerRuninngJsonValue.toString() == "true"));
-    isRunning = (isTimerRuninngJsonValue.isBool() && isTimerRuninngJsonValue.toBool());
+    applyStatus(itemDoc.object(), true);
+}
+
+void TCTimer::pageTimerChanged(QByteArray buffer)
+{
+    QJsonObject rootObject = QJsonDocument::fromJson(buffer).object();
+    QJsonValue isTimerRunningJsonValue = rootObject.value("isTimerRunning");
+    bool pageIsRunning = isTimerRunningJsonValue.isString() ? isTimerRunningJsonValue.toString() == "true" : isTimerRunningJsonValue.toBool();
+    qint64 pageTimerId = rootObject.value("timer_id").toVariant().toLongLong();
+
+    // the same timer may have been renamed, but the page's elapsed is only as fresh as the page's last request
+    bool sameTimer = pageIsRunning == isRunning && (!isRunning || pageTimerId == timer_id);
+    applyStatus(rootObject, false);
+    if (!sameTimer) {
+        // started or stopped in the page; get the exact time from the server, once the page's call has returned
+        // (status() waits for the reply in a nested event loop)
+        QTimer::singleShot(0, this, &TCTimer::status);
+    }
+}
+
+void TCTimer::applyStatus(const QJsonObject &rootObject, bool elapsedIsCurrent)
+{
+    bool previousIsRunning = isRunning;
+    QString previousName = name;
+
+    QJsonValue isTimerRunningJsonValue = rootObject.value("isTimerRunning");
+    if (isTimerRunningJsonValue.isString()) {
+        isRunning = isTimerRunningJsonValue.toString() == "true";
+    } else {
+        isRunning = isTimerRunningJsonValue.toBool();
+    }
     if (isRunning) {
-        QJsonValue elapsedJsonVal = rootObject.value("elapsed");
-        if (elapsedJsonVal.isString()) {
-            elapsed = elapsedJsonVal.toString().toInt();
-        } else {
-            elapsed = elapsedJsonVal.toInt();
-        }
-        task_id = rootObject.value("task_id").toString().toInt();
-        entry_id = rootObject.value("entry_id").toString().toInt();
-        timer_id = rootObject.value("timer_id").toString().toInt();
-        external_task_id = rootObject.value("external_task_id").toString().toInt();
+        qint64 previousTimerId = timer_id;
+        // ids come as strings or numbers
+        task_id = rootObject.value("task_id").toVariant().toLongLong();
+        entry_id = rootObject.value("entry_id").toVariant().toLongLong();
+        timer_id = rootObject.value("timer_id").toVariant().toLongLong();
+        external_task_id = rootObject.value("external_task_id").toVariant().toLongLong();
         name = rootObject.value("name").toString();
         if(name.isEmpty() && task_id != 0) {
-            Task *taskObj = DbManager::instance().getTaskById(task_id);
+            TaskPtr taskObj = DbManager::instance().getTaskById(task_id);
             if(taskObj != nullptr) {
                 name = taskObj->getName();
             }
         }
-        start_time = rootObject.value("external_task_id").toString();
+        start_time = rootObject.value("start_time").toString();
+        if (elapsedIsCurrent || !previousIsRunning || previousTimerId != timer_id) {
+            setElapsed(rootObject.value("elapsed").toVariant().toLongLong());
+        }
     } else {
         clearData();
     }
     QJsonValue newTimerId = rootObject.value("new_timer_id");
     if(!newTimerId.isUndefined() && !newTimerId.isNull()) {
-        timer_id = newTimerId.toInt();
-        elapsed = 1; // let's say it's been running for 1 sec, just to show some time
+        timer_id = newTimerId.toVariant().toLongLong();
         isRunning = true;
+        setElapsed(0); // started just now
+        QTimer::singleShot(0, this, &TCTimer::status); // for the task's name; not from inside this reply
     }
 
     if (previousIsRunning != isRunning || previousName != name) {
         emit timerStatusChanged(isRunning, name);
     }
-    emit timerElapsedSeconds(elapsed);
+    if (isRunning) {
+        tickTimer.start();
+    } else {
+        tickTimer.stop();
+    }
+    emitElapsed();
+}
+
+void TCTimer::setElapsed(qint64 seconds)
+{
+    elapsed = seconds;
+    elapsedSince.start();
+}
+
+qint64 TCTimer::elapsedSeconds() const
+{
+    if (!isRunning) {
+        return 0;
+    }
+    return elapsed + elapsedSince.elapsed() / 1000;
+}
+
+void TCTimer::emitElapsed()
+{
+    emit timerElapsedSeconds(elapsedSeconds());
 }
 
 void TCTimer::clearData()
 {
     isRunning = false;
     elapsed = 0;
+    elapsedSince.invalidate();
     task_id = 0;
     entry_id = 0;
     timer_id = 0;
@@ -123,7 +179,7 @@ void TCTimer::clearData()
     start_time = QString("");
 }
 
-void TCTimer::startTaskByTaskObj(Task *task, bool force)
+void TCTimer::startTaskByTaskObj(TaskPtr task, bool force)
 {
     if (force || timer_id == 0 || timer_id != task->getTaskId()) {
         this->start(task->getTaskId());
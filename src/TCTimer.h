@@ -7,6 +7,14 @@
 #include "DbManager.h"
 #include "Settings.h"
 
+/**
+ * @brief The timer state the whole app shows: the tray, FloatingWidget and (through MainWidget) the web view
+ *
+ * The server says how long the timer has run; from then on, elapsed time is counted here on a monotonic clock
+ * (so sleep, clock changes and missed ticks don't make it drift) and sent out every second.
+ * The server is asked again only when something changed (start, stop, the page's timer is a different one)
+ * or every TIMER_RECONCILE_INTERVAL_MS.
+ */
 class TCTimer : public QObject
 {
 Q_OBJECT
@@ -15,20 +23,29 @@ Q_OBJECT
 private:
     Comms *comms;
     bool isRunning = false;
-    qint64 elapsed = 0;
+    qint64 elapsed = 0; // seconds, as of elapsedSince
+    QElapsedTimer elapsedSince;
+    QTimer tickTimer;
+    QTimer reconcileTimer;
     qint64 task_id;
     qint64 entry_id;
     qint64 timer_id;
     qint64 external_task_id;
     QString name;
     QString start_time;
-    qint64 lastStatusCheck;
+    QElapsedTimer sinceStatusCheck;
+
+    void applyStatus(const QJsonObject &rootObject, bool elapsedIsCurrent);
+    void setElapsed(qint64 seconds);
+    void emitElapsed();
 
 public:
     explicit TCTimer(Comms *comms);
     void decideTimerReply(QNetworkReply *reply, QByteArray buffer);
     void timerStatusReply(QByteArray buffer);
+    void pageTimerChanged(QByteArray buffer);
     void clearData();
+    qint64 elapsedSeconds() const;
 
 signals:
     void timerStatusChanged(bool, QString);
@@ -38,7 +55,7 @@ public slots:
     void start(qint64 taskID = 0, qint64 entryID = 0, qint64 startedAtInMS = 0);
     void stop(qint64 timerID = 0, qint64 stoppedAtInMS = 0);
     void status();
-    void startTaskByTaskObj(Task *task, bool force);
+    void startTaskByTaskObj(TaskPtr task, bool force);
     void startTaskByID(qint64 taskID);
     void startTimerSlot();
     void stopTimerSlot();
@@ -35,7 +35,7 @@ void Task::setKeywords(QString keywords) {
     this->setKeywordsList(receivedKeywordsList);
 }
 
-QStringList Task::getKeywordsList() {
+const QStringList &Task::getKeywordsList() const {
     return keywordsList;
 }
 
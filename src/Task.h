@@ -1,6 +1,8 @@
 #ifndef TIMECAMPDESKTOP_TASK_H
 #define TIMECAMPDESKTOP_TASK_H
 
+#include <memory>
+#include <QMetaType>
 #include <QString>
 #include <QtCore/QVector>
 
@@ -24,9 +26,13 @@ public:
     const QString &getKeywords() const;
     void setKeywords(QString keywords);
 
-    QStringList getKeywordsList();
+    const QStringList &getKeywordsList() const;
     void setKeywordsList(QStringList keywordsList);
 };
 
 
+// tasks are shared read-only once published, see TaskCatalog
+using TaskPtr = std::shared_ptr<const Task>;
+Q_DECLARE_METATYPE(TaskPtr)
+
 #endif //TIMECAMPDESKTOP_TASK_H
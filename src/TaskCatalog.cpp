@@ -0,0 +1,26 @@
+#include "TaskCatalog.h"
+
+TaskCatalog::TaskCatalog(QHash<qint64, TaskPtr> tasks, quint64 generation)
+    : taskById(std::move(tasks)), catalogGeneration(generation)
+{
+}
+
+TaskPtr TaskCatalog::task(qint64 taskId) const
+{
+    return taskById.value(taskId);
+}
+
+const QHash<qint64, TaskPtr> &TaskCatalog::tasks() const
+{
+    return taskById;
+}
+
+int TaskCatalog::size() const
+{
+    return taskById.size();
+}
+
+quint64 TaskCatalog::generation() const
+{
+    return catalogGeneration;
+}
@@ -0,0 +1,35 @@
+#ifndef TIMECAMPDESKTOP_TASKCATALOG_H
+#define TIMECAMPDESKTOP_TASKCATALOG_H
+
+#include <memory>
+#include <QHash>
+
+#include "Task.h"
+
+/**
+ * @brief All tasks of the account, as one immutable snapshot
+ *
+ * A catalog never changes after it is built; a new task list from the server becomes a new catalog,
+ * which DbManager publishes atomically. Readers on any thread take a TaskCatalogPtr and keep
+ * a consistent view for as long as they hold it, and every TaskPtr handed out stays valid while it's held,
+ * even after the catalog it came from was replaced.
+ */
+class TaskCatalog
+{
+public:
+    TaskCatalog() = default;
+    TaskCatalog(QHash<qint64, TaskPtr> tasks, quint64 generation);
+
+    TaskPtr task(qint64 taskId) const;
+    const QHash<qint64, TaskPtr> &tasks() const;
+    int size() const;
+    quint64 generation() const; // increases with every published catalog
+
+private:
+    QHash<qint64, TaskPtr> taskById;
+    quint64 catalogGeneration = 0;
+};
+
+using TaskCatalogPtr = std::shared_ptr<const TaskCatalog>;
+
+#endif //TIMECAMPDESKTOP_TASKCATALOG_H
@@ -0,0 +1,46 @@
+#include "TaskIngest.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QVector>
+
+#include "ParallelChunks.h"
+
+namespace TaskIngest
+{
+    QHash<qint64, TaskPtr> parseTasksReply(const QByteArray &buffer)
+    {
+        // the document itself can only be parsed in one go; turning its objects into tasks can be split
+        const QJsonObject rootObject = QJsonDocument::fromJson(buffer).object();
+        QVector<QJsonValue> taskValues;
+        taskValues.reserve(rootObject.size());
+        for (auto it = rootObject.constBegin(); it != rootObject.constEnd(); ++it) {
+            taskValues.append(it.value());
+        }
+
+        QVector<QVector<TaskPtr>> chunks = ParallelChunks::map<QVector<TaskPtr>>(
+            taskValues.size(), 1024, [&taskValues](int begin, int end)
+            {
+                QVector<TaskPtr> chunk;
+                chunk.reserve(end - begin);
+                for (int i = begin; i < end; i++) {
+                    QJsonObject oneTask = taskValues[i].toObject();
+                    auto task = std::make_shared<Task>(oneTask.value("task_id").toString().toLongLong());
+                    task->setName(oneTask.value("name").toString());
+                    task->setKeywords(oneTask.value("tags").toString()); // splits the keywords, too
+                    chunk.append(std::move(task));
+                }
+                return chunk;
+            });
+
+        QHash<qint64, TaskPtr> tasks;
+        tasks.reserve(taskValues.size());
+        for (const QVector<TaskPtr> &chunk : qAsConst(chunks)) {
+            for (const TaskPtr &task : chunk) {
+                tasks.insert(task->getTaskId(), task);
+            }
+        }
+        return tasks;
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef TIMECAMPDESKTOP_TASKINGEST_H
+#define TIMECAMPDESKTOP_TASKINGEST_H
+
+#include <QByteArray>
+#include <QHash>
+
+#include "Task.h"
+
+namespace TaskIngest
+{
+    // tasks of a /tasks API reply; big replies are converted in parallel chunks, see ParallelChunks
+    QHash<qint64, TaskPtr> parseTasksReply(const QByteArray &buffer);
+}
+
+#endif //TIMECAMPDESKTOP_TASKINGEST_H
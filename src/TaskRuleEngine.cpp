@@ -0,0 +1,318 @@
+#include "TaskRuleEngine.h"
+
+#include <QDebug>
+#include <QUrl>
+
+#include <algorithm>
+
+#include "ParallelChunks.h"
+
+static bool isInteger(const QString &text)
+{
+    int start = text.startsWith('-') ? 1 : 0;
+    if (text.size() <= start || text.size() > start + 9) {
+        return false;
+    }
+    for (int i = start; i < text.size(); i++) {
+        if (!text[i].isDigit()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int TaskRuleEngine::Rule::matchLength(const QString &foldedValue, const QString &value) const
+{
+    switch (kind) {
+        case Contains:
+            return foldedValue.contains(pattern) ? pattern.size() : -1;
+        case Exact:
+            return foldedValue == pattern ? pattern.size() : -1;
+        case Prefix:
+            return foldedValue.startsWith(pattern) ? pattern.size() : -1;
+        case Suffix:
+            return foldedValue.endsWith(pattern) ? pattern.size() : -1;
+        case RegExp: {
+            QRegularExpressionMatch match = regExp.match(value);
+            return match.hasMatch() ? match.capturedLength() : -1;
+        }
+    }
+    return -1;
+}
+
+int TaskRuleEngine::Rule::specificity() const
+{
+    int kindRank = 0;
+    switch (kind) {
+        case Exact:
+            kindRank = 4;
+            break;
+        case Prefix:
+        case Suffix:
+            kindRank = 3;
+            break;
+        case Contains:
+            kindRank = 2;
+            break;
+        case RegExp:
+            kindRank = 1;
+            break;
+    }
+    return kindRank * 2 + (field != AnyField ? 1 : 0);
+}
+
+bool TaskRuleEngine::Match::betterThan(const Match &other) const
+{
+    if (other.taskId < 0) {
+        return taskId >= 0;
+    }
+    if (priority != other.priority) {
+        return priority > other.priority;
+    }
+    if (length != other.length) {
+        return length > other.length;
+    }
+    if (specificity != other.specificity) {
+        return specificity > other.specificity;
+    }
+    return taskId < other.taskId;
+}
+
+bool TaskRuleEngine::parseRule(const QString &keyword, qint64 taskId, Rule &rule)
+{
+    QString text = keyword.trimmed();
+    rule = Rule();
+    rule.taskId = taskId;
+    rule.source = text;
+
+    int priorityAt = text.lastIndexOf('@');
+    if (priorityAt > 0 && isInteger(text.mid(priorityAt + 1))) {
+        rule.priority = text.midRef(priorityAt + 1).toInt();
+        text = text.left(priorityAt).trimmed();
+    }
+
+    int fieldEnd = text.indexOf(':');
+    if (fieldEnd > 0) {
+        static const QHash<QString, Field> fieldNames{
+            {"app", AppField}, {"title", TitleField}, {"url", UrlField}, {"domain", DomainField}
+        };
+        auto field = fieldNames.constFind(text.left(fieldEnd).trimmed().toLower());
+        if (field != fieldNames.constEnd()) {
+            rule.field = field.value();
+            text = text.mid(fieldEnd + 1).trimmed();
+        }
+    }
+
+    if (text.size() > 2 && text.startsWith('/') && text.endsWith('/')) {
+        rule.kind = RegExp;
+        rule.regExp = QRegularExpression(text.mid(1, text.size() - 2), QRegularExpression::CaseInsensitiveOption);
+        if (!rule.regExp.isValid()) {
+            qWarning() << "[AutoTracking] Invalid regex in keyword" << keyword << ":" << rule.regExp.errorString();
+            return false;
+        }
+        rule.regExp.optimize();
+        return true;
+    }
+
+    if (text.startsWith('=')) {
+        rule.kind = Exact;
+        text = text.mid(1);
+    } else {
+        bool atStart = text.startsWith('^');
+        bool atEnd = text.size() > 1 && text.endsWith('$');
+        text = text.mid(atStart ? 1 : 0, text.size() - (atStart ? 1 : 0) - (atEnd ? 1 : 0));
+        if (atStart && atEnd) {
+            rule.kind = Exact;
+        } else if (atStart) {
+            rule.kind = Prefix;
+        } else if (atEnd) {
+            rule.kind = Suffix;
+        }
+    }
+
+    rule.pattern = text.toCaseFolded();
+    return !rule.pattern.isEmpty();
+}
+
+QString TaskRuleEngine::domainOf(const QString &url)
+{
+    if (url.isEmpty()) {
+        return QString();
+    }
+    return QUrl::fromUserInput(url).host();
+}
+
+const char *TaskRuleEngine::fieldName(Field field)
+{
+    switch (field) {
+        case AppField:
+            return "app";
+        case TitleField:
+            return "title";
+        case UrlField:
+            return "url";
+        case DomainField:
+            return "domain";
+        default:
+            return "any";
+    }
+}
+
+bool TaskRuleEngine::FieldPlan::isEmpty() const
+{
+    return contains.isEmpty() && exact.isEmpty() && prefixes.isEmpty() && suffixes.isEmpty() && regExps.isEmpty();
+}
+
+void TaskRuleEngine::setTasks(const QHash<qint64, TaskPtr> &tasks)
+{
+    QVector<qint64> taskIds;
+    taskIds.reserve(tasks.size());
+    for (auto it = tasks.constBegin(); it != tasks.constEnd(); ++it) {
+        taskIds.append(it.key());
+    }
+    std::sort(taskIds.begin(), taskIds.end());
+
+    // parsing (regexes above all) is split over the thread pool; chunks come back in task ID order
+    QVector<QVector<Rule>> parsedChunks = ParallelChunks::map<QVector<Rule>>(
+        taskIds.size(), 512, [&tasks, &taskIds](int begin, int end)
+        {
+            QVector<Rule> chunk;
+            for (int i = begin; i < end; i++) {
+                for (const QString &keyword : tasks.value(taskIds[i])->getKeywordsList()) {
+                    Rule rule;
+                    if (parseRule(keyword, taskIds[i], rule)) {
+                        chunk.append(rule);
+                    }
+                }
+            }
+            return chunk;
+        });
+
+    ruleList.clear();
+    for (const QVector<Rule> &chunk : qAsConst(parsedChunks)) {
+        ruleList += chunk;
+    }
+
+    // every field has its own plan, so they can be built at the same time
+    int fieldsPerChunk = ruleList.size() >= 4096 ? 1 : FieldCount;
+    ParallelChunks::map<bool>(FieldCount, fieldsPerChunk, [this](int begin, int end)
+    {
+        for (int field = begin; field < end; field++) {
+            buildPlan(static_cast<Field>(field));
+        }
+        return true;
+    });
+}
+
+void TaskRuleEngine::buildPlan(Field field)
+{
+    FieldPlan &plan = plans[field];
+    plan = FieldPlan();
+    for (int ruleIndex = 0; ruleIndex < ruleList.size(); ruleIndex++) {
+        Field ruleField = ruleList[ruleIndex].field;
+        if (ruleField == field || (ruleField == AnyField && field != DomainField)) {
+            addToPlan(plan, ruleIndex);
+        }
+    }
+    plan.contains.compile();
+}
+
+void TaskRuleEngine::addToPlan(FieldPlan &plan, int ruleIndex) const
+{
+    const Rule &rule = ruleList[ruleIndex];
+    switch (rule.kind) {
+        case Contains:
+            plan.contains.add(rule.pattern, ruleIndex);
+            break;
+        case Exact:
+            plan.exact[rule.pattern].append(ruleIndex);
+            break;
+        case Prefix:
+            plan.prefixes[rule.pattern.size()][rule.pattern].append(ruleIndex);
+            break;
+        case Suffix:
+            plan.suffixes[rule.pattern.size()][rule.pattern].append(ruleIndex);
+            break;
+        case RegExp:
+            plan.regExps.append(ruleIndex);
+            break;
+    }
+}
+
+TaskRuleEngine::Match TaskRuleEngine::evaluate(const QString &appName, const QString &windowTitle, const QString &url) const
+{
+    Match best;
+    evaluateField(AppField, appName, best);
+    evaluateField(TitleField, windowTitle, best);
+    evaluateField(UrlField, url, best);
+    if (!plans[DomainField].isEmpty()) {
+        evaluateField(DomainField, domainOf(url), best);
+    }
+    return best;
+}
+
+void TaskRuleEngine::evaluateField(Field field, const QString &value, Match &best) const
+{
+    const FieldPlan &plan = plans[field];
+    if (value.isEmpty() || plan.isEmpty()) {
+        return;
+    }
+    const QString folded = value.toCaseFolded();
+
+    for (qint64 ruleIndex : plan.contains.findAll(value)) {
+        consider(static_cast<int>(ruleIndex), ruleList[static_cast<int>(ruleIndex)].pattern.size(), field, best);
+    }
+
+    for (int ruleIndex : plan.exact.value(folded)) {
+        consider(ruleIndex, folded.size(), field, best);
+    }
+
+    // one lookup per distinct prefix / suffix length, the keys point into folded without copying it
+    for (auto it = plan.prefixes.constBegin(); it != plan.prefixes.constEnd(); ++it) {
+        if (it.key() <= folded.size()) {
+            for (int ruleIndex : it.value().value(QString::fromRawData(folded.constData(), it.key()))) {
+                consider(ruleIndex, it.key(), field, best);
+            }
+        }
+    }
+    for (auto it = plan.suffixes.constBegin(); it != plan.suffixes.constEnd(); ++it) {
+        if (it.key() <= folded.size()) {
+            const QChar *suffix = folded.constData() + folded.size() - it.key();
+            for (int ruleIndex : it.value().value(QString::fromRawData(suffix, it.key()))) {
+                consider(ruleIndex, it.key(), field, best);
+            }
+        }
+    }
+
+    for (int ruleIndex : plan.regExps) {
+        int length = ruleList[ruleIndex].matchLength(folded, value);
+        if (length >= 0) {
+            consider(ruleIndex, length, field, best);
+        }
+    }
+}
+
+void TaskRuleEngine::consider(int ruleIndex, int length, Field field, Match &best) const
+{
+    const Rule &rule = ruleList[ruleIndex];
+    Match candidate;
+    candidate.taskId = rule.taskId;
+    candidate.priority = rule.priority;
+    candidate.length = length;
+    candidate.specificity = rule.specificity();
+    candidate.rule = ruleIndex;
+    candidate.field = field;
+    if (candidate.betterThan(best)) {
+        best = candidate;
+    }
+}
+
+const QVector<TaskRuleEngine::Rule> &TaskRuleEngine::rules() const
+{
+    return ruleList;
+}
+
+const TaskRuleEngine::Rule &TaskRuleEngine::rule(const Match &match) const
+{
+    return ruleList[match.rule];
+}
@@ -0,0 +1,113 @@
+#ifndef TIMECAMPDESKTOP_TASKRULEENGINE_H
+#define TIMECAMPDESKTOP_TASKRULEENGINE_H
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+#include "KeywordAutomaton.h"
+#include "Task.h"
+
+/**
+ * @brief Matches activities to tasks with the rules written in task keywords
+ *
+ * Every comma separated keyword of a task is one rule:
+ *   [field:]pattern[@priority]
+ * field is app, title, url or domain (without it: app name, window title or URL);
+ * pattern is "text" (anywhere), "=text" (the whole field), "^text" (at the start), "text$" (at the end)
+ * or "/regex/"; all of them are case-insensitive. priority is an integer, 0 when not given.
+ *
+ * When several rules match, the best one wins: higher priority, then the longer match,
+ * then the more specific rule (exact > anchored > anywhere > regex, one field > any field), then the lower task ID.
+ *
+ * setTasks() compiles the rules into a plan per field: one Aho-Corasick automaton for all "anywhere" rules,
+ * hash lookups for exact, prefix and suffix rules (by length), and the regexes; evaluate() then looks
+ * at every field once, whatever the number of rules. For big task lists, setTasks() parses the rules and builds
+ * the plans on the global thread pool; it still returns only when everything is built.
+ */
+class TaskRuleEngine
+{
+public:
+    enum Field
+    {
+        AnyField = -1,
+        AppField,
+        TitleField,
+        UrlField,
+        DomainField,
+        FieldCount
+    };
+
+    enum Kind
+    {
+        Contains,
+        Exact,
+        Prefix,
+        Suffix,
+        RegExp
+    };
+
+    struct Rule
+    {
+        qint64 taskId = -1;
+        Field field = AnyField;
+        Kind kind = Contains;
+        int priority = 0;
+        QString pattern; // case-folded; empty for regexes
+        QRegularExpression regExp;
+        QString source; // the keyword as written
+
+        // length of the match in the (case-folded) value, -1 when it doesn't match
+        int matchLength(const QString &foldedValue, const QString &value) const;
+        int specificity() const;
+    };
+
+    struct Match
+    {
+        qint64 taskId = -1;
+        int priority = 0;
+        int length = 0;
+        int specificity = 0;
+        int rule = -1;
+        Field field = AnyField;
+
+        bool betterThan(const Match &other) const;
+    };
+
+    // a keyword as a rule; returns false (and logs why) for keywords that can't be used
+    static bool parseRule(const QString &keyword, qint64 taskId, Rule &rule);
+    static QString domainOf(const QString &url);
+    static const char *fieldName(Field field);
+
+    void setTasks(const QHash<qint64, TaskPtr> &tasks);
+    Match evaluate(const QString &appName, const QString &windowTitle, const QString &url) const;
+
+    const QVector<Rule> &rules() const;
+    const Rule &rule(const Match &match) const;
+
+private:
+    // rule indexes, by the case-folded text they have to be equal to
+    using RuleLookup = QHash<QString, QVector<int>>;
+
+    struct FieldPlan
+    {
+        KeywordAutomaton contains; // ids are rule indexes
+        RuleLookup exact;
+        QHash<int, RuleLookup> prefixes; // by prefix length
+        QHash<int, RuleLookup> suffixes; // by suffix length
+        QVector<int> regExps;
+
+        bool isEmpty() const;
+    };
+
+    QVector<Rule> ruleList;
+    FieldPlan plans[FieldCount];
+
+    void buildPlan(Field field);
+    void addToPlan(FieldPlan &plan, int ruleIndex) const;
+    void evaluateField(Field field, const QString &value, Match &best) const;
+    void consider(int ruleIndex, int length, Field field, Match &best) const;
+};
+
+#endif //TIMECAMPDESKTOP_TASKRULEENGINE_H
@@ -0,0 +1,11 @@
+#ifndef TIMECAMPDESKTOP_ALLOCATIONCOUNTER_H
+#define TIMECAMPDESKTOP_ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+// heap allocations made by the process so far; linking this in replaces the allocator entry points
+quint64 allocationCount();
+// what allocationCount() can see on this platform, for reports
+const char *allocationCountLabel();
+
+#endif //TIMECAMPDESKTOP_ALLOCATIONCOUNTER_H
@@ -0,0 +1,112 @@
+//
+// LogBench.cpp
+// Measures what logging costs the threads that log: qDebug() latency (p50 / p99 / max) and messages per second,
+// through the queued LOGUTILS handler, and how long writing out the queue takes at shutdown.
+// With --legacy the same load goes through a handler that opens, appends and closes the log file per message,
+// like LOGUTILS did before; with --binary the queued handler writes a binary log (see src/BinaryLog.h).
+// Logs go to the test mode data location (QStandardPaths::setTestModeEnabled), not to the app's logs.
+//
+// Usage: TimeCampLogBench [--threads N] [--messages N] [--legacy | --binary]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QStandardPaths>
+
+#include "third-party/QTLogRotation/logutils.h"
+
+static QString legacyLogFileName;
+static QMutex legacyMutex;
+
+static void legacyMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    Q_UNUSED(type);
+    Q_UNUSED(context);
+    QMutexLocker locker(&legacyMutex);
+    QFile outFile(legacyLogFileName);
+    if (outFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        outFile.write(QString("[00:00:00] Debug:\t%1\n").arg(msg).toUtf8());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("TimeCampLogBench");
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the log message handler under concurrent load.");
+    parser.addHelpOption();
+    QCommandLineOption threadsOption("threads", "Threads logging at the same time.", "count", "4");
+    QCommandLineOption messagesOption("messages", "Messages per thread.", "count", "50000");
+    QCommandLineOption legacyOption("legacy", "Open, write and close the log file for every message.");
+    QCommandLineOption binaryOption("binary", "Write a binary log instead of text.");
+    parser.addOptions({threadsOption, messagesOption, legacyOption, binaryOption});
+    parser.process(app);
+
+    int threadCount = qMax(1, parser.value(threadsOption).toInt());
+    int messageCount = qMax(1, parser.value(messagesOption).toInt());
+    bool legacy = parser.isSet(legacyOption);
+
+    if (legacy) {
+        QString folder = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/logs";
+        QDir().mkpath(folder);
+        legacyLogFileName = folder + "/LogBench_legacy.txt";
+        QFile::remove(legacyLogFileName);
+        qInstallMessageHandler(legacyMessageHandler);
+    } else if (!LOGUTILS::initLogging(false, parser.isSet(binaryOption) ? LOGUTILS::BinaryFormat : LOGUTILS::TextFormat)) {
+        std::fprintf(stderr, "Can't open the log file\n");
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::vector<qint64>> latencies(static_cast<size_t>(threadCount));
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([t, messageCount, &latencies]
+        {
+            std::vector<qint64> &mine = latencies[static_cast<size_t>(t)];
+            mine.reserve(static_cast<size_t>(messageCount));
+            for (int i = 0; i < messageCount; i++) {
+                Clock::time_point before = Clock::now();
+                qDebug() << "[LogBench] thread" << t << "message" << i << "window title: Inbox - Mail";
+                mine.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count());
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    Clock::time_point logged = Clock::now();
+    if (!legacy) {
+        LOGUTILS::shutdownLogging();
+    }
+    Clock::time_point flushed = Clock::now();
+
+    std::vector<qint64> all;
+    for (const std::vector<qint64> &mine : latencies) {
+        all.insert(all.end(), mine.begin(), mine.end());
+    }
+    std::sort(all.begin(), all.end());
+    double loggedSeconds = std::chrono::duration<double>(logged - start).count();
+
+    std::printf("handler:          %s\n", legacy ? "legacy (open per message)" : parser.isSet(binaryOption) ? "queued, binary" : "queued");
+    std::printf("messages:         %zu (%d threads)\n", all.size(), threadCount);
+    std::printf("messages/s:       %.0f\n", all.size() / loggedSeconds);
+    std::printf("latency p50:      %.2f us\n", all[all.size() / 2] / 1e3);
+    std::printf("latency p99:      %.2f us\n", all[all.size() * 99 / 100] / 1e3);
+    std::printf("latency max:      %.2f us\n", all.back() / 1e3);
+    std::printf("shutdown flush:   %.2f ms\n", std::chrono::duration<double, std::milli>(flushed - logged).count());
+    return 0;
+}
@@ -0,0 +1,101 @@
+//
+// LogDecoder.cpp
+// Turns binary logs (Log_*.tclog, written when the BINARY_LOG setting is on) back into text,
+// in the same layout as the text logs plus the date, milliseconds and logging category, or into JSON lines.
+// --stats prints to stderr how much smaller the binary files are than the text they decode to.
+//
+// Usage: TimeCampLogDecoder [--json] [--stats] <log.tclog>...
+//
+
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "src/BinaryLog.h"
+
+static QByteArray renderText(const BinaryLogEvent &event)
+{
+    QString line = QString("[%1] %2:\t")
+        .arg(QDateTime::fromMSecsSinceEpoch(event.msSinceEpoch, Qt::UTC).toString("yyyy-MM-dd HH:mm:ss.zzz"))
+        .arg(BinaryLog::levelName(event.type));
+    if (event.category != QLatin1String("default")) {
+        line += "[" + event.category + "] ";
+    }
+    line += event.message + "\n";
+    if (event.repeated > 0) {
+        line += QString("^ repeated x%1\n").arg(event.repeated);
+    }
+    return line.toUtf8();
+}
+
+static QByteArray renderJson(const BinaryLogEvent &event)
+{
+    QJsonObject object;
+    object.insert("time", QDateTime::fromMSecsSinceEpoch(event.msSinceEpoch, Qt::UTC).toString(Qt::ISODateWithMs));
+    object.insert("level", QString(BinaryLog::levelName(event.type)).toLower());
+    object.insert("category", event.category);
+    object.insert("message", event.message);
+    if (event.repeated > 0) {
+        object.insert("repeated", static_cast<qint64>(event.repeated));
+    }
+    return QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Decodes binary TimeCamp Desktop logs to text or JSON lines.");
+    parser.addHelpOption();
+    QCommandLineOption jsonOption("json", "One JSON object per event instead of text.");
+    QCommandLineOption statsOption("stats", "Print binary and decoded sizes to stderr.");
+    parser.addOptions({jsonOption, statsOption});
+    parser.addPositionalArgument("logs", "Binary log files, decoded in the given order.", "<log.tclog>...");
+    parser.process(app);
+
+    const QStringList paths = parser.positionalArguments();
+    if (paths.isEmpty()) {
+        parser.showHelp(1);
+    }
+    bool json = parser.isSet(jsonOption);
+
+    int result = 0;
+    qint64 binaryBytes = 0;
+    qint64 textBytes = 0;
+    qint64 eventCount = 0;
+    for (const QString &path : paths) {
+        BinaryLogReader reader(path);
+        if (!reader.isOpen()) {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(path), qPrintable(reader.errorString()));
+            result = 1;
+            continue;
+        }
+
+        BinaryLogEvent event;
+        while (reader.readNext(event)) {
+            QByteArray out = json ? renderJson(event) : renderText(event);
+            std::fwrite(out.constData(), 1, static_cast<size_t>(out.size()), stdout);
+            textBytes += json ? renderText(event).size() : out.size();
+            eventCount += 1 + static_cast<qint64>(event.repeated);
+        }
+        if (!reader.errorString().isEmpty()) {
+            // a log that was being written when the app died ends with a partial record; the rest is still good
+            std::fprintf(stderr, "%s: %s\n", qPrintable(path), qPrintable(reader.errorString()));
+        }
+        binaryBytes += QFileInfo(path).size();
+    }
+
+    if (parser.isSet(statsOption)) {
+        std::fprintf(stderr, "events:      %lld\n", eventCount);
+        std::fprintf(stderr, "binary:      %lld bytes\n", binaryBytes);
+        std::fprintf(stderr, "as text:     %lld bytes\n", textBytes);
+        std::fprintf(stderr, "ratio:       %.1fx\n", binaryBytes > 0 ? static_cast<double>(textBytes) / binaryBytes : 0.0);
+    }
+    return result;
+}
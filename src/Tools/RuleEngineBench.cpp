@@ -0,0 +1,218 @@
+//
+// RuleEngineBench.cpp
+// Measures AutoTracking rule matching as the number of rules grows: compiling the rules of all tasks,
+// and matching activities with the compiled plan, compared with checking every rule in turn.
+// Both have to pick the same task for every activity, otherwise the tool fails.
+//
+// Usage: TimeCampRuleEngineBench [--rules 10,100,1000,10000] [--activities N] [--regex-percent P]
+//
+
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include "src/Task.h"
+#include "src/TaskRuleEngine.h"
+
+struct Activity
+{
+    QString appName;
+    QString windowTitle;
+    QString url;
+};
+
+static quint32 nextRandom(quint32 &state)
+{
+    state = state * 1103515245u + 12345u;
+    return state >> 8;
+}
+
+static QString word(quint32 &state)
+{
+    static const char *const syllables[] = {"ka", "to", "mi", "ren", "sol", "va", "dex", "lu", "qor", "ta", "ni", "bel"};
+    QString result;
+    int count = 2 + static_cast<int>(nextRandom(state) % 3);
+    for (int i = 0; i < count; i++) {
+        result += syllables[nextRandom(state) % 12];
+    }
+    return result;
+}
+
+// keywords in the shapes people write them, mostly plain words
+static QString keyword(quint32 &state, int regexPercent)
+{
+    QString text = word(state);
+    int shape = static_cast<int>(nextRandom(state) % 100);
+    if (shape < regexPercent) {
+        return "/" + text + "-\\d+/";
+    }
+    shape = static_cast<int>(nextRandom(state) % 20);
+    switch (shape) {
+        case 0:
+            return "app:=" + text;
+        case 1:
+            return "title:^" + text;
+        case 2:
+            return text + "$";
+        case 3:
+            return "domain:" + text + ".com";
+        case 4:
+            return "url:" + text + "@5";
+        default:
+            return text;
+    }
+}
+
+static QHash<qint64, TaskPtr> generateTasks(int ruleCount, int regexPercent, QStringList &usedWords)
+{
+    QHash<qint64, TaskPtr> tasks;
+    quint32 state = static_cast<quint32>(ruleCount);
+    int rules = 0;
+    for (qint64 taskId = 1000; rules < ruleCount; taskId++) {
+        QStringList keywords;
+        int perTask = 1 + static_cast<int>(nextRandom(state) % 3);
+        for (int i = 0; i < perTask && rules < ruleCount; i++, rules++) {
+            keywords.append(keyword(state, regexPercent));
+        }
+        auto task = std::make_shared<Task>(taskId);
+        task->setName(QString("Task %1").arg(taskId));
+        task->setKeywords(keywords.join(','));
+        tasks.insert(taskId, task);
+    }
+    for (int i = 0; i < 64; i++) {
+        usedWords.append(word(state));
+    }
+    return tasks;
+}
+
+static QVector<Activity> generateActivities(int count, const QStringList &words)
+{
+    static const char *const apps[] = {"chrome", "firefox", "code", "slack", "Terminal", "WINWORD"};
+    QVector<Activity> activities;
+    activities.reserve(count);
+    quint32 state = 7;
+    for (int i = 0; i < count; i++) {
+        const QString &first = words[nextRandom(state) % words.size()];
+        const QString &second = words[nextRandom(state) % words.size()];
+        Activity activity;
+        activity.appName = apps[nextRandom(state) % 6];
+        activity.windowTitle = first + " - " + second + "-" + QString::number(i % 97) + " | Example Project";
+        if (nextRandom(state) % 2 == 0) {
+            activity.url = "https://www." + second + ".com/issues/" + first + "?page=" + QString::number(i);
+        }
+        activities.append(activity);
+    }
+    return activities;
+}
+
+// the same rules and scoring, checking every rule against every field
+static TaskRuleEngine::Match evaluateEveryRule(const TaskRuleEngine &engine, const Activity &activity)
+{
+    const QString values[] = {activity.appName, activity.windowTitle, activity.url, TaskRuleEngine::domainOf(activity.url)};
+    QString folded[TaskRuleEngine::FieldCount];
+    for (int field = 0; field < TaskRuleEngine::FieldCount; field++) {
+        folded[field] = values[field].toCaseFolded();
+    }
+
+    TaskRuleEngine::Match best;
+    const QVector<TaskRuleEngine::Rule> &rules = engine.rules();
+    for (int ruleIndex = 0; ruleIndex < rules.size(); ruleIndex++) {
+        const TaskRuleEngine::Rule &rule = rules[ruleIndex];
+        for (int field = 0; field < TaskRuleEngine::FieldCount; field++) {
+            bool applies = rule.field == field || (rule.field == TaskRuleEngine::AnyField && field != TaskRuleEngine::DomainField);
+            if (!applies || values[field].isEmpty()) {
+                continue;
+            }
+            int length = rule.matchLength(folded[field], values[field]);
+            if (length < 0) {
+                continue;
+            }
+            TaskRuleEngine::Match candidate;
+            candidate.taskId = rule.taskId;
+            candidate.priority = rule.priority;
+            candidate.length = length;
+            candidate.specificity = rule.specificity();
+            candidate.rule = ruleIndex;
+            candidate.field = static_cast<TaskRuleEngine::Field>(field);
+            if (candidate.betterThan(best)) {
+                best = candidate;
+            }
+        }
+    }
+    return best;
+}
+
+static bool sameResult(const TaskRuleEngine::Match &a, const TaskRuleEngine::Match &b)
+{
+    return a.taskId == b.taskId && a.priority == b.priority && a.length == b.length && a.specificity == b.specificity;
+}
+
+static bool benchmarkRuleCount(int ruleCount, int activityCount, int regexPercent)
+{
+    QStringList words;
+    QHash<qint64, TaskPtr> tasks = generateTasks(ruleCount, regexPercent, words);
+    QVector<Activity> activities = generateActivities(activityCount, words);
+
+    TaskRuleEngine engine;
+    QElapsedTimer timer;
+    timer.start();
+    engine.setTasks(tasks);
+    qint64 compileNs = timer.nsecsElapsed();
+
+    QVector<TaskRuleEngine::Match> planResults(activities.size());
+    timer.start();
+    for (int i = 0; i < activities.size(); i++) {
+        const Activity &activity = activities[i];
+        planResults[i] = engine.evaluate(activity.appName, activity.windowTitle, activity.url);
+    }
+    qint64 planNs = timer.nsecsElapsed();
+
+    QVector<TaskRuleEngine::Match> everyRuleResults(activities.size());
+    timer.start();
+    for (int i = 0; i < activities.size(); i++) {
+        everyRuleResults[i] = evaluateEveryRule(engine, activities[i]);
+    }
+    qint64 everyRuleNs = timer.nsecsElapsed();
+
+    int matched = 0;
+    int mismatches = 0;
+    for (int i = 0; i < activities.size(); i++) {
+        matched += planResults[i].taskId >= 0;
+        if (!sameResult(planResults[i], everyRuleResults[i]) && mismatches++ < 5) {
+            std::fprintf(stderr, "  different match for \"%s\": plan task %lld, every rule task %lld\n",
+                         qPrintable(activities[i].windowTitle), planResults[i].taskId, everyRuleResults[i].taskId);
+        }
+    }
+
+    std::printf("%7d rules (%5d tasks): compile %8.3f ms, plan %8.2f us/activity, every rule %9.2f us/activity, %d/%d matched\n",
+                engine.rules().size(), tasks.size(), compileNs / 1e6, planNs / 1e3 / activityCount,
+                everyRuleNs / 1e3 / activityCount, matched, activityCount);
+
+    return mismatches == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks AutoTracking rule matching for growing numbers of rules.");
+    parser.addHelpOption();
+    QCommandLineOption rulesOption("rules", "Comma separated rule counts.", "counts", "10,100,1000,10000");
+    QCommandLineOption activitiesOption("activities", "Activities matched per rule count.", "count", "2000");
+    QCommandLineOption regexOption("regex-percent", "Share of rules that are regexes.", "percent", "2");
+    parser.addOptions({rulesOption, activitiesOption, regexOption});
+    parser.process(app);
+
+    int activityCount = qMax(1, parser.value(activitiesOption).toInt());
+    int regexPercent = qBound(0, parser.value(regexOption).toInt(), 100);
+
+    bool ok = true;
+    for (const QString &count : parser.value(rulesOption).split(',', QString::SkipEmptyParts)) {
+        ok = benchmarkRuleCount(qMax(1, count.toInt()), activityCount, regexPercent) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+//
+// SessionBench.cpp
+// Measures how long it takes to get the active URL out of Firefox session files:
+// reading + decompressing the file, then extracting the selected tab's URL,
+// compared with building a whole QJsonDocument for the same lookup.
+//
+// Usage: TimeCampSessionBench [--iterations N] [--generate MB] [session files...]
+// --generate writes a synthetic session shaped like a real one (many windows and tabs, long histories,
+// favicons and principals) of roughly the given size to the temp dir, and benchmarks it too.
+//
+
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#include "src/FirefoxUtils.h"
+#include "third-party/mozilla_lz4/lz4.h"
+#include "AllocationCounter.h"
+
+struct StageResult
+{
+    qint64 minNs = -1;
+    qint64 totalNs = 0;
+    quint64 allocations = 0;
+    int runs = 0;
+
+    void add(qint64 ns, quint64 allocationsMade)
+    {
+        minNs = minNs < 0 ? ns : qMin(minNs, ns);
+        totalNs += ns;
+        allocations += allocationsMade;
+        runs++;
+    }
+
+    void print(const char *name, qint64 bytes) const
+    {
+        if (runs == 0) {
+            return;
+        }
+        double avgMs = totalNs / 1e6 / runs;
+        std::printf("  %-22s avg %8.3f ms, min %8.3f ms, %8.1f MB/s, %6.1f %s per run\n",
+                    name, avgMs, minNs / 1e6, bytes / 1e6 / (avgMs / 1e3),
+                    double(allocations) / runs, allocationCountLabel());
+    }
+};
+
+static QByteArray randomishToken(int seed, int length)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    QByteArray token(length, 'A');
+    quint32 state = static_cast<quint32>(seed) * 2654435761u + 1;
+    for (int i = 0; i < length; i++) {
+        state = state * 1103515245u + 12345u;
+        token[i] = alphabet[(state >> 16) % 64];
+    }
+    return token;
+}
+
+static QByteArray syntheticEntry(int window, int tab, int entry)
+{
+    QByteArray url = "https://example.com/w" + QByteArray::number(window) + "/t" + QByteArray::number(tab)
+                     + "/e" + QByteArray::number(entry) + "?q=" + randomishToken(entry, 24);
+    return "{\"url\":\"" + url + "\",\"title\":\"Page " + QByteArray::number(entry) + " of tab " + QByteArray::number(tab)
+           + " \\u2013 Example\",\"charset\":\"UTF-8\",\"ID\":" + QByteArray::number(window * 100000 + tab * 100 + entry)
+           + ",\"docshellUUID\":\"{" + randomishToken(tab + entry, 36) + "}\",\"referrerInfo\":\"" + randomishToken(entry, 120)
+           + "\",\"triggeringPrincipal_base64\":\"{\\\"3\\\":{}}\",\"hasUserInteraction\":true,\"persist\":true,"
+           + "\"scroll\":\"0," + QByteArray::number(entry * 37 % 4000) + "\",\"formdata\":{\"id\":{\"q\":\"search " + QByteArray::number(entry) + "\"}}}";
+}
+
+// returns the URL a correct extraction has to find
+static QByteArray writeSyntheticSession(const QString &path, int targetMegabytes)
+{
+    const int windowCount = 3;
+    const int entriesPerTab = 25;
+    const qint64 targetBytes = static_cast<qint64>(targetMegabytes) * 1024 * 1024;
+    const int selectedWindow = 2; // 1-based, like in the real file
+
+    QByteArray json;
+    json.reserve(static_cast<int>(targetBytes + targetBytes / 8));
+    json += "{\"version\":[\"sessionrestore\",1],\"windows\":[";
+
+    QByteArray expectedURL;
+    qint64 bytesPerWindow = targetBytes / windowCount;
+    for (int window = 0; window < windowCount; window++) {
+        json += window > 0 ? ",{\"tabs\":[" : "{\"tabs\":[";
+        qint64 windowStart = json.size();
+        int tab = 0;
+        int selectedTab = 0;
+        while (json.size() - windowStart < bytesPerWindow || tab < 2) {
+            json += tab > 0 ? ",{\"entries\":[" : "{\"entries\":[";
+            for (int entry = 0; entry < entriesPerTab; entry++) {
+                if (entry > 0) {
+                    json += ',';
+                }
+                json += syntheticEntry(window, tab, entry);
+            }
+            json += "],\"requestedIndex\":0,\"lastAccessed\":1589000000000,\"hidden\":false,\"attributes\":{},"
+                    "\"image\":\"data:image/png;base64," + randomishToken(tab, 600) + "\",\"index\":"
+                    + QByteArray::number(entriesPerTab) + ",\"userContextId\":0}";
+            tab++;
+        }
+        selectedTab = tab / 2;
+        if (window + 1 == selectedWindow) {
+            expectedURL = "https://example.com/w" + QByteArray::number(window) + "/t" + QByteArray::number(selectedTab)
+                          + "/e" + QByteArray::number(entriesPerTab - 1) + "?q=" + randomishToken(entriesPerTab - 1, 24);
+        }
+        json += "],\"selected\":" + QByteArray::number(selectedTab + 1)
+                + ",\"_closedTabs\":[],\"busy\":false,\"width\":1920,\"height\":1080,\"screenX\":0,\"screenY\":0,\"sizemode\":\"maximized\","
+                  "\"cookies\":[{\"host\":\"example.com\",\"value\":\"" + randomishToken(window, 200) + "\",\"path\":\"/\",\"name\":\"sid\"}]}";
+    }
+    json += "],\"selectedWindow\":" + QByteArray::number(selectedWindow)
+            + ",\"_closedWindows\":[],\"session\":{\"lastUpdate\":1589000000000,\"startTime\":1588000000000,\"recentCrashes\":0},"
+              "\"global\":{},\"cookies\":[]}";
+
+    // mozLz40\0, decompressed size as 32-bit little endian, then a raw LZ4 block
+    QByteArray compressed(LZ4_compressBound(json.size()), Qt::Uninitialized);
+    int compressedSize = LZ4_compress_default(json.constData(), compressed.data(), json.size(), compressed.size());
+    QByteArray header("mozLz40\0", 8);
+    for (int i = 0; i < 4; i++) {
+        header += static_cast<char>((json.size() >> (8 * i)) & 0xFF);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return QByteArray();
+    }
+    file.write(header);
+    file.write(compressed.constData(), compressedSize);
+    return expectedURL;
+}
+
+// what getCurrentURLFromFirefoxConfig used to do, as the baseline and a cross-check
+static QString urlFromJsonDocument(const QByteArray &session)
+{
+    QJsonObject root = QJsonDocument::fromJson(session).object();
+    QJsonObject window = root.value("windows").toArray().at(root.value("selectedWindow").toInt() - 1).toObject();
+    QJsonObject tab = window.value("tabs").toArray().at(window.value("selected").toInt() - 1).toObject();
+    QJsonArray entries = tab.value("entries").toArray();
+    return entries.isEmpty() ? QString() : entries.last().toObject().value("url").toString();
+}
+
+static QByteArray readSession(const QString &path)
+{
+    if (path.endsWith(".jsonlz4")) {
+        return parseJsonlz4RecoveryFilePath(path);
+    }
+    return parseJsRecoveryFilePath(path);
+}
+
+static bool benchmarkFile(const QString &path, int iterations, const QByteArray &expectedURL)
+{
+    QByteArray session = readSession(path); // warm up the page cache and the decompression buffer
+    if (session.isEmpty()) {
+        std::fprintf(stderr, "Can't read session: %s\n", qPrintable(path));
+        return false;
+    }
+    qint64 sessionBytes = session.size();
+    QString url = getCurrentURLFromFirefoxConfig(session);
+
+    std::printf("\n%s: %.1f MB on disk, %.1f MB of JSON\n", qPrintable(path),
+                QFileInfo(path).size() / 1e6, sessionBytes / 1e6);
+    std::printf("  active URL: %s\n", qPrintable(url));
+    if (!expectedURL.isEmpty() && url != QString::fromLatin1(expectedURL)) {
+        std::fprintf(stderr, "  wrong URL, expected %s\n", expectedURL.constData());
+        return false;
+    }
+    QString documentURL = urlFromJsonDocument(session);
+    if (url != documentURL) {
+        std::fprintf(stderr, "  QJsonDocument found a different URL: %s\n", qPrintable(documentURL));
+        return false;
+    }
+
+    StageResult readResult;
+    StageResult extractResult;
+    StageResult documentResult;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; i++) {
+        quint64 allocationsBefore = allocationCount();
+        timer.start();
+        session = readSession(path);
+        readResult.add(timer.nsecsElapsed(), allocationCount() - allocationsBefore);
+
+        allocationsBefore = allocationCount();
+        timer.start();
+        url = getCurrentURLFromFirefoxConfig(session);
+        extractResult.add(timer.nsecsElapsed(), allocationCount() - allocationsBefore);
+
+        allocationsBefore = allocationCount();
+        timer.start();
+        documentURL = urlFromJsonDocument(session);
+        documentResult.add(timer.nsecsElapsed(), allocationCount() - allocationsBefore);
+    }
+
+    readResult.print("read + decompress", sessionBytes);
+    extractResult.print("extract URL", sessionBytes);
+    documentResult.print("QJsonDocument baseline", sessionBytes);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks reading the active URL from Firefox session files.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("sessions", "recovery.jsonlz4 / sessionstore.js files to measure.", "[sessions...]");
+    QCommandLineOption iterationsOption("iterations", "Runs per file.", "count", "20");
+    QCommandLineOption generateOption("generate", "Also generate and measure a synthetic session of about this many MB of JSON.", "MB");
+    parser.addOptions({iterationsOption, generateOption});
+    parser.process(app);
+
+    int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    bool ok = true;
+
+    if (parser.isSet(generateOption)) {
+        int megabytes = qMax(1, parser.value(generateOption).toInt());
+        QString path = QDir::temp().filePath(QString("timecamp-session-bench-%1MB.jsonlz4").arg(megabytes));
+        QByteArray expectedURL = writeSyntheticSession(path, megabytes);
+        if (expectedURL.isEmpty()) {
+            std::fprintf(stderr, "Can't write %s\n", qPrintable(path));
+            return 1;
+        }
+        ok = benchmarkFile(path, iterations, expectedURL) && ok;
+    }
+
+    for (const QString &path : parser.positionalArguments()) {
+        ok = benchmarkFile(path, iterations, QByteArray()) && ok;
+    }
+
+    if (!parser.isSet(generateOption) && parser.positionalArguments().isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+//
+// StringKernelsBench.cpp
+// Measures the case-insensitive "does this title/process name contain any of these words" checks
+// done for every window event: toLower() + QRegExp (what the app used to do),
+// QString::contains(..., Qt::CaseInsensitive) per word, and StringKernels.
+// All three have to agree on every line, otherwise the tool fails.
+//
+// Usage: TimeCampStringKernelsBench [--iterations N] [--titles file]
+// --titles reads one window title per line; without it a built-in set of typical titles is used.
+//
+
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+#include <QTextStream>
+
+#include "src/StringKernels.h"
+
+struct NeedleSet
+{
+    const char *name;
+    QStringList words;
+};
+
+static QStringList builtInTitles()
+{
+    return {
+        "chrome",
+        "firefox",
+        "msedge",
+        "explorer",
+        "Visual Studio Code",
+        "Inbox (3) - someone@example.com - Gmail - Google Chrome",
+        "TimeCamp - Time Tracking Software | Log in - Mozilla Firefox",
+        "Pull requests · timecamp/desktop-app - Brave",
+        "main.cpp - timecamp-v2.1-desktop-app - Visual Studio Code",
+        "Zażółć gęślą jaźń – dokument.docx - Word",
+        "Документ без названия - Google Документы - Яндекс.Браузер",
+        "会議メモ - Microsoft Teams",
+        "Spotify Premium",
+        "Slack | #general | TimeCamp",
+        "● Untitled-1 - Sublime Text (UNREGISTERED)",
+        "Terminal — bash — 80×24",
+        "Create free account - TimeCamp - Opera",
+        "YouTube - Mozilla Firefox Private Browsing",
+        "Calculator",
+        "A rather long document title that goes on and on, the way some web pages name their tabs, "
+        "with a site name at the very end - Example News Network - Vivaldi",
+    };
+}
+
+static QStringList readTitles(const QString &path)
+{
+    QStringList titles;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return titles;
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    while (!stream.atEnd()) {
+        QString line = stream.readLine();
+        if (!line.isEmpty()) {
+            titles.append(line);
+        }
+    }
+    return titles;
+}
+
+static bool containsAnyQt(const QString &haystack, const QStringList &words)
+{
+    for (const QString &word : words) {
+        if (haystack.contains(word, Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void printResult(const char *name, qint64 ns, int checks)
+{
+    std::printf("  %-26s %9.3f ms, %7.1f ns per check\n", name, ns / 1e6, double(ns) / checks);
+}
+
+static bool benchmarkSet(const NeedleSet &set, const QStringList &titles, int iterations)
+{
+    QRegExp regExp(set.words.join('|'));
+
+    int mismatches = 0;
+    for (const QString &title : titles) {
+        bool byRegExp = title.toLower().contains(regExp);
+        bool byQt = containsAnyQt(title, set.words);
+        bool byKernel = StringKernels::containsAnyCaseInsensitive(title, set.words);
+        if (byRegExp != byKernel || byQt != byKernel) {
+            std::fprintf(stderr, "  results differ for \"%s\": QRegExp %d, QString %d, StringKernels %d\n",
+                         qPrintable(title), byRegExp, byQt, byKernel);
+            mismatches++;
+        }
+    }
+
+    // the sums keep the compiler from dropping the loops
+    int found[3] = {0, 0, 0};
+    qint64 elapsed[3] = {0, 0, 0};
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        for (const QString &title : titles) {
+            found[0] += title.toLower().contains(regExp);
+        }
+    }
+    elapsed[0] = timer.nsecsElapsed();
+
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        for (const QString &title : titles) {
+            found[1] += containsAnyQt(title, set.words);
+        }
+    }
+    elapsed[1] = timer.nsecsElapsed();
+
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        for (const QString &title : titles) {
+            found[2] += StringKernels::containsAnyCaseInsensitive(title, set.words);
+        }
+    }
+    elapsed[2] = timer.nsecsElapsed();
+
+    int checks = iterations * titles.size();
+    std::printf("\n%s (%d words, %d of %d lines match)\n", set.name, set.words.size(), found[2] / iterations, titles.size());
+    printResult("toLower() + QRegExp", elapsed[0], checks);
+    printResult("QString::contains", elapsed[1], checks);
+    printResult("StringKernels", elapsed[2], checks);
+    return mismatches == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks case-insensitive keyword checks on window titles.");
+    parser.addHelpOption();
+    QCommandLineOption iterationsOption("iterations", "Passes over the titles.", "count", "2000");
+    QCommandLineOption titlesOption("titles", "File with one window title per line.", "file");
+    parser.addOptions({iterationsOption, titlesOption});
+    parser.process(app);
+
+    int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    QStringList titles = parser.isSet(titlesOption) ? readTitles(parser.value(titlesOption)) : builtInTitles();
+    if (titles.isEmpty()) {
+        std::fprintf(stderr, "No titles to measure\n");
+        return 1;
+    }
+
+    // the lists WindowEvents_W and MainWidget check against
+    const NeedleSet sets[] = {
+        {"firefox", {"firefox"}},
+        {"Chromium-based browsers", {"chrome", "epic", "opera", "cent", "slimjet", "sleipnir", "silk", "blisk", "yandex", "iron"}},
+        {"other browsers", {"microsoftedge", "netscp6", "mozilla", "netscape", "vivaldi", "brave", "ucbrowser", "browser"}},
+        {"logged out page titles", {"log in", "login", "register", "create free account", "create account", "time tracking software", "blog"}},
+    };
+
+    std::printf("StringKernels kernel: %s, %d titles, %d iterations\n", StringKernels::kernelName(), titles.size(), iterations);
+    bool ok = true;
+    for (const NeedleSet &set : sets) {
+        ok = benchmarkSet(set, titles, iterations) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+//
+// TaskIngestBench.cpp
+// Measures what happens off the GUI thread when a /tasks reply arrives: parsing it into tasks
+// (TaskIngest::parseTasksReply) and compiling their keywords into AutoTracking rules (TaskRuleEngine::setTasks),
+// for a range of task counts and thread pool sizes.
+//
+// Usage: TimeCampTaskIngestBench [--tasks 1000,10000,50000] [--threads 1,2,4,8] [--iterations N]
+//
+
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QThreadPool>
+
+#include "src/TaskIngest.h"
+#include "src/TaskRuleEngine.h"
+
+// shaped like the real reply: an object of task objects keyed by task ID, most without keywords
+static QByteArray generateTasksReply(int taskCount)
+{
+    static const char *const words[] = {"invoice", "design", "review", "backend", "client", "sprint", "docs", "support"};
+    QJsonObject root;
+    for (int i = 0; i < taskCount; i++) {
+        QString taskId = QString::number(100000 + i);
+        QJsonObject task;
+        task.insert("task_id", taskId);
+        task.insert("parent_id", QString::number(100000 + i / 20));
+        task.insert("name", QString("%1 %2 #%3").arg(words[i % 8], words[(i / 8) % 8]).arg(i));
+        task.insert("level", "2");
+        task.insert("archived", "0");
+        task.insert("color", "#4CAF50");
+        QString tags;
+        switch (i % 4) {
+            case 0:
+                tags = QString("%1-%2,title:^%3").arg(words[i % 8]).arg(i).arg(words[(i / 3) % 8]);
+                break;
+            case 1:
+                tags = QString("domain:%1%2.example.com@2").arg(words[i % 8]).arg(i % 500);
+                break;
+            case 2:
+                if (i % 40 == 2) {
+                    tags = QString("/%1-\\d+/").arg(words[i % 8]);
+                }
+                break;
+            default:
+                break;
+        }
+        task.insert("tags", tags);
+        root.insert(taskId, task);
+    }
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+static QVector<int> parseCounts(const QString &list)
+{
+    QVector<int> counts;
+    for (const QString &count : list.split(',', QString::SkipEmptyParts)) {
+        counts.append(qMax(1, count.toInt()));
+    }
+    return counts;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks parsing a tasks reply and compiling task rules, by task and thread count.");
+    parser.addHelpOption();
+    QCommandLineOption tasksOption("tasks", "Comma separated task counts.", "counts", "1000,10000,50000");
+    QCommandLineOption threadsOption("threads", "Comma separated thread pool sizes.", "counts",
+                                     QString("1,2,4,%1").arg(QThread::idealThreadCount()));
+    QCommandLineOption iterationsOption("iterations", "Runs per combination, the best one is reported.", "count", "5");
+    parser.addOptions({tasksOption, threadsOption, iterationsOption});
+    parser.process(app);
+
+    int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    QVector<int> threadCounts = parseCounts(parser.value(threadsOption));
+
+    std::printf("%8s %8s %8s %12s %12s %12s\n", "tasks", "threads", "rules", "parse ms", "compile ms", "total ms");
+    for (int taskCount : parseCounts(parser.value(tasksOption))) {
+        QByteArray reply = generateTasksReply(taskCount);
+        for (int threads : threadCounts) {
+            QThreadPool::globalInstance()->setMaxThreadCount(threads);
+
+            qint64 bestParseNs = -1;
+            qint64 bestCompileNs = -1;
+            int ruleCount = 0;
+            QElapsedTimer timer;
+            for (int i = 0; i < iterations; i++) {
+                timer.start();
+                QHash<qint64, TaskPtr> tasks = TaskIngest::parseTasksReply(reply);
+                qint64 parseNs = timer.nsecsElapsed();
+
+                timer.start();
+                TaskRuleEngine engine;
+                engine.setTasks(tasks);
+                qint64 compileNs = timer.nsecsElapsed();
+
+                if (tasks.size() != taskCount) {
+                    std::fprintf(stderr, "Parsed %d tasks instead of %d\n", tasks.size(), taskCount);
+                    return 1;
+                }
+                ruleCount = engine.rules().size();
+                bestParseNs = bestParseNs < 0 ? parseNs : qMin(bestParseNs, parseNs);
+                bestCompileNs = bestCompileNs < 0 ? compileNs : qMin(bestCompileNs, compileNs);
+            }
+            std::printf("%8d %8d %8d %12.2f %12.2f %12.2f\n", taskCount, threads, ruleCount,
+                        bestParseNs / 1e6, bestCompileNs / 1e6, (bestParseNs + bestCompileNs) / 1e6);
+        }
+    }
+    return 0;
+}
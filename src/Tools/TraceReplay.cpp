@@ -0,0 +1,211 @@
+//
+// TraceReplay.cpp
+// Pushes a recorded activity trace through the real saving pipeline as fast as possible:
+// WindowEvents::logAppName -> Comms::saveApp -> DbManager::saveAppToDb + AutoTracking::checkAppKeywords
+// and reports events/sec, allocations and per-stage latency histograms.
+//
+// Usage: TimeCampTraceReplay [--tasks tasks.json] [--autotracking] [--repeat N] <trace>
+//
+
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QVector>
+
+#include "src/Settings.h"
+#include "src/SettingsSnapshot.h"
+#include "src/Comms.h"
+#include "src/DbManager.h"
+#include "src/AutoTracking.h"
+#include "src/DataCollector/WindowEvents.h"
+#include "src/DataCollector/ActivityTrace.h"
+#include "AllocationCounter.h"
+
+// gives the replay access to the same entry point the OS collectors use
+class TraceFeeder : public WindowEvents
+{
+public:
+    using WindowEvents::logAppName;
+
+protected:
+    void run() override {}
+    unsigned long getIdleTime() override { return 0; }
+};
+
+// power-of-two buckets, in microseconds
+class LatencyHistogram
+{
+public:
+    explicit LatencyHistogram(const char *name) : name(name), buckets(40, 0) {}
+
+    void add(qint64 nanoseconds)
+    {
+        quint64 micros = static_cast<quint64>(nanoseconds) / 1000;
+        int bucket = 0;
+        while (micros > 0 && bucket < buckets.size() - 1) {
+            micros >>= 1;
+            bucket++;
+        }
+        buckets[bucket]++;
+        count++;
+        totalNs += static_cast<quint64>(nanoseconds);
+        maxNs = qMax(maxNs, static_cast<quint64>(nanoseconds));
+    }
+
+    // upper bound of the bucket the percentile falls into
+    quint64 percentileMicros(double percentile) const
+    {
+        auto wanted = static_cast<quint64>(count * percentile);
+        quint64 seen = 0;
+        for (int i = 0; i < buckets.size(); i++) {
+            seen += buckets[i];
+            if (seen > wanted) {
+                return i == 0 ? 1 : (1ull << i);
+            }
+        }
+        return maxNs / 1000;
+    }
+
+    void print() const
+    {
+        if (count == 0) {
+            std::printf("\n%s: no samples\n", name);
+            return;
+        }
+        std::printf("\n%s: %llu samples, avg %.1f us, p50 <%llu us, p90 <%llu us, p99 <%llu us, max %.1f us\n",
+                    name, count, totalNs / 1000.0 / count,
+                    percentileMicros(0.5), percentileMicros(0.9), percentileMicros(0.99), maxNs / 1000.0);
+        for (int i = 0; i < buckets.size(); i++) {
+            if (buckets[i] > 0) {
+                std::printf("  <%10llu us | %10llu\n", i == 0 ? 1ull : (1ull << i), buckets[i]);
+            }
+        }
+    }
+
+private:
+    const char *name;
+    QVector<quint64> buckets;
+    quint64 count = 0;
+    quint64 totalNs = 0;
+    quint64 maxNs = 0;
+};
+
+int main(int argc, char *argv[])
+{
+    // own settings and DB, so replays never touch the real app data
+    QCoreApplication::setOrganizationName(ORGANIZATION_NAME);
+    QCoreApplication::setOrganizationDomain(ORGANIZATION_DOMAIN);
+    QCoreApplication::setApplicationName(APPLICATION_NAME " Trace Replay");
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays an activity trace through the saving pipeline and measures it.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("trace", "Binary trace recorded with --capture-trace.");
+    QCommandLineOption tasksOption("tasks", "JSON reply of the /tasks API endpoint, to match keywords against.", "file");
+    QCommandLineOption autoTrackingOption("autotracking", "Run keyword matching for every saved activity.");
+    QCommandLineOption repeatOption("repeat", "Replay the trace this many times.", "count", "1");
+    parser.addOptions({tasksOption, autoTrackingOption, repeatOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().isEmpty()) {
+        parser.showHelp(1);
+    }
+    QString tracePath = parser.positionalArguments().first();
+    int repeat = qMax(1, parser.value(repeatOption).toInt());
+    bool autoTrackingEnabled = parser.isSet(autoTrackingOption);
+
+    // start from an empty DB every time, so results are comparable
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(dataDir);
+    QFile::remove(dataDir + "/" + DB_FILENAME);
+
+    QSettings settings;
+    settings.setValue(SETT_TRACK_AUTO_SWITCH, autoTrackingEnabled);
+    settings.sync();
+    SettingsService::instance().reload();
+
+    DbManager &dbManager = DbManager::instance();
+    AutoTracking &autoTracking = AutoTracking::instance();
+    Comms &comms = Comms::instance();
+
+    if (parser.isSet(tasksOption)) {
+        QFile tasksFile(parser.value(tasksOption));
+        if (!tasksFile.open(QIODevice::ReadOnly)) {
+            std::fprintf(stderr, "Can't read tasks file\n");
+            return 1;
+        }
+        comms.tasksReply(tasksFile.readAll());
+        comms.waitForTasks();
+        autoTracking.waitForTaskRules();
+    }
+
+    LatencyHistogram totalLatency("logAppName (whole pipeline)");
+    LatencyHistogram dbLatency("DbManager::saveAppToDb");
+    LatencyHistogram autoTrackingLatency("AutoTracking::checkAppKeywords");
+
+    QObject::connect(&comms, &Comms::DbSaveApp, [&](AppData *savedApp)
+    {
+        QElapsedTimer stageTimer;
+        stageTimer.start();
+        dbManager.saveAppToDb(savedApp);
+        dbLatency.add(stageTimer.nsecsElapsed());
+
+        if (autoTrackingEnabled) {
+            autoTracking.setLastUpdate(0); // measure matching on every activity, not once per threshold
+        }
+        stageTimer.restart();
+        autoTracking.checkAppKeywords(savedApp);
+        autoTrackingLatency.add(stageTimer.nsecsElapsed());
+    });
+
+    ActivityTraceReader reader(tracePath);
+    if (!reader.isOpen()) {
+        std::fprintf(stderr, "Can't read trace: %s\n", qPrintable(tracePath));
+        return 1;
+    }
+
+    qint64 eventCount = 0;
+    QElapsedTimer wallClock;
+    QElapsedTimer eventTimer;
+    ActivityTraceEvent event;
+    quint64 allocationsBefore = allocationCount();
+    wallClock.start();
+
+    for (int i = 0; i < repeat; i++) {
+        reader.rewind();
+        while (reader.readNext(event)) {
+            eventTimer.start();
+            TraceFeeder::logAppName(event.appName, event.windowName, event.additionalInfo);
+            totalLatency.add(eventTimer.nsecsElapsed());
+            eventCount++;
+        }
+    }
+
+    qint64 elapsedNs = wallClock.nsecsElapsed();
+    quint64 allocations = allocationCount() - allocationsBefore;
+
+    std::printf("Replayed %lld events in %.3f s: %.0f events/sec\n",
+                eventCount, elapsedNs / 1e9, elapsedNs > 0 ? eventCount * 1e9 / elapsedNs : 0.0);
+    std::printf("%llu %s, %.1f per event\n",
+                allocations, allocationCountLabel(), eventCount > 0 ? double(allocations) / eventCount : 0.0);
+    totalLatency.print();
+    dbLatency.print();
+    autoTrackingLatency.print();
+    if (autoTrackingEnabled) {
+        quint64 lookups = autoTracking.getMatchCacheHits() + autoTracking.getMatchCacheMisses();
+        std::printf("AutoTracking match cache: %llu hits, %llu misses, %.1f%% hit rate\n",
+                    autoTracking.getMatchCacheHits(), autoTracking.getMatchCacheMisses(),
+                    lookups > 0 ? 100.0 * autoTracking.getMatchCacheHits() / lookups : 0.0);
+    }
+
+    return 0;
+}
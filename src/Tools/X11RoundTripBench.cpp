@@ -0,0 +1,290 @@
+//
+// X11RoundTripBench.cpp
+// Runs the real Linux collector (WindowEvents_U) against the X server in $DISPLAY (Xvfb is enough, no window
+// manager needed), switches between windows it creates by setting _NET_ACTIVE_WINDOW, renames them, and counts
+// how many times the collector had to wait for the X server per window switch and per title change.
+//
+// A round-trip is a reply wait that isn't covered by an earlier one: replies to requests that were queued
+// before the collector last waited come in with that wait, so batched requests count once.
+// The collector's xcb calls are counted through -Wl,--wrap (see CMakeLists.txt), so its code runs unchanged.
+//
+// Usage: TimeCampX11RoundTripBench [--windows N] [--switches N]
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <unistd.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QThread>
+#include <QVector>
+
+#include <xcb/xcb.h>
+
+#include "src/Settings.h"
+#include "src/SettingsSnapshot.h"
+#include "src/Metrics.h"
+#include "src/DataCollector/WindowEvents_U.h"
+
+// how long the collector gets to log one change
+static const int LOG_TIMEOUT_MS = 2000;
+
+namespace
+{
+    xcb_connection_t *benchConnection = nullptr; // the bench's own requests aren't counted
+
+    std::atomic<quint64> roundTrips{0};
+    std::atomic<unsigned int> lastSentSequence{0};
+    std::atomic<unsigned int> coveredSequence{0};
+
+    bool isCounted(xcb_connection_t *connection)
+    {
+        return connection != benchConnection;
+    }
+
+    void noteSent(xcb_connection_t *connection, unsigned int sequence)
+    {
+        if (isCounted(connection)) {
+            lastSentSequence = sequence;
+        }
+    }
+
+    void noteWait(xcb_connection_t *connection, unsigned int sequence)
+    {
+        if (isCounted(connection) && sequence > coveredSequence) {
+            // xcb flushes everything queued so far, and their replies come back with this one
+            roundTrips++;
+            coveredSequence = lastSentSequence.load();
+        }
+    }
+}
+
+extern "C" {
+xcb_get_property_cookie_t __real_xcb_get_property(xcb_connection_t *, uint8_t, xcb_window_t, xcb_atom_t, xcb_atom_t, uint32_t, uint32_t);
+xcb_get_property_reply_t *__real_xcb_get_property_reply(xcb_connection_t *, xcb_get_property_cookie_t, xcb_generic_error_t **);
+xcb_intern_atom_cookie_t __real_xcb_intern_atom(xcb_connection_t *, uint8_t, uint16_t, const char *);
+xcb_intern_atom_reply_t *__real_xcb_intern_atom_reply(xcb_connection_t *, xcb_intern_atom_cookie_t, xcb_generic_error_t **);
+xcb_void_cookie_t __real_xcb_change_window_attributes(xcb_connection_t *, xcb_window_t, uint32_t, const void *);
+
+xcb_get_property_cookie_t __wrap_xcb_get_property(xcb_connection_t *c, uint8_t _delete, xcb_window_t window, xcb_atom_t property,
+                                                  xcb_atom_t type, uint32_t long_offset, uint32_t long_length)
+{
+    xcb_get_property_cookie_t cookie = __real_xcb_get_property(c, _delete, window, property, type, long_offset, long_length);
+    noteSent(c, cookie.sequence);
+    return cookie;
+}
+
+xcb_get_property_reply_t *__wrap_xcb_get_property_reply(xcb_connection_t *c, xcb_get_property_cookie_t cookie, xcb_generic_error_t **e)
+{
+    noteWait(c, cookie.sequence);
+    return __real_xcb_get_property_reply(c, cookie, e);
+}
+
+xcb_intern_atom_cookie_t __wrap_xcb_intern_atom(xcb_connection_t *c, uint8_t only_if_exists, uint16_t name_len, const char *name)
+{
+    xcb_intern_atom_cookie_t cookie = __real_xcb_intern_atom(c, only_if_exists, name_len, name);
+    noteSent(c, cookie.sequence);
+    return cookie;
+}
+
+xcb_intern_atom_reply_t *__wrap_xcb_intern_atom_reply(xcb_connection_t *c, xcb_intern_atom_cookie_t cookie, xcb_generic_error_t **e)
+{
+    noteWait(c, cookie.sequence);
+    return __real_xcb_intern_atom_reply(c, cookie, e);
+}
+
+xcb_void_cookie_t __wrap_xcb_change_window_attributes(xcb_connection_t *c, xcb_window_t window, uint32_t value_mask, const void *value_list)
+{
+    xcb_void_cookie_t cookie = __real_xcb_change_window_attributes(c, window, value_mask, value_list);
+    noteSent(c, cookie.sequence);
+    return cookie;
+}
+}
+
+class RoundTripStats
+{
+public:
+    explicit RoundTripStats(const char *name) : name(name) {}
+
+    void add(quint64 value)
+    {
+        values.append(value);
+    }
+
+    void print() const
+    {
+        if (values.isEmpty()) {
+            std::printf("%-14s no samples\n", name);
+            return;
+        }
+        quint64 total = 0;
+        quint64 min = values.first();
+        quint64 max = values.first();
+        for (quint64 value : values) {
+            total += value;
+            min = qMin(min, value);
+            max = qMax(max, value);
+        }
+        std::printf("%-14s %6d samples, round-trips: avg %.2f, min %llu, max %llu\n",
+                    name, values.size(), static_cast<double>(total) / values.size(), min, max);
+    }
+
+private:
+    const char *name;
+    QVector<quint64> values;
+};
+
+static xcb_atom_t internAtom(const char *name)
+{
+    xcb_intern_atom_cookie_t cookie = xcb_intern_atom(benchConnection, 0, static_cast<uint16_t>(std::strlen(name)), name);
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(benchConnection, cookie, nullptr);
+    xcb_atom_t atom = reply != nullptr ? reply->atom : XCB_ATOM_NONE;
+    free(reply);
+    return atom;
+}
+
+// waits until the collector logged one more activity than before; false on timeout
+static bool waitForLog(MetricCounter &logged, quint64 before)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (logged.value() <= before) {
+        if (timer.elapsed() > LOG_TIMEOUT_MS) {
+            return false;
+        }
+        QThread::msleep(1);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    // own settings and DB, so the bench never touches the real app data
+    QCoreApplication::setOrganizationName(ORGANIZATION_NAME);
+    QCoreApplication::setOrganizationDomain(ORGANIZATION_DOMAIN);
+    QCoreApplication::setApplicationName(APPLICATION_NAME " X11 Round Trip Bench");
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Counts X server round-trips of the Linux collector per window switch and title change.");
+    parser.addHelpOption();
+    QCommandLineOption windowsOption("windows", "Windows to switch between.", "count", "8");
+    QCommandLineOption switchesOption("switches", "Window switches (and as many title changes) to make.", "count", "200");
+    parser.addOptions({windowsOption, switchesOption});
+    parser.process(app);
+
+    int windowCount = qMax(2, parser.value(windowsOption).toInt());
+    int switchCount = qMax(1, parser.value(switchesOption).toInt());
+
+    // start from an empty DB every time
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(dataDir);
+    QFile::remove(dataDir + "/" + DB_FILENAME);
+    QSettings settings;
+    settings.setValue(SETT_TRACK_AUTO_SWITCH, false);
+    settings.sync();
+    SettingsService::instance().reload();
+
+    int screenNumber = 0;
+    benchConnection = xcb_connect(nullptr, &screenNumber);
+    if (xcb_connection_has_error(benchConnection)) {
+        std::fprintf(stderr, "Can't connect to the X server; set DISPLAY (Xvfb :99 & DISPLAY=:99 ...)\n");
+        return 1;
+    }
+    xcb_screen_iterator_t screens = xcb_setup_roots_iterator(xcb_get_setup(benchConnection));
+    for (; screens.rem && screenNumber > 0; --screenNumber) {
+        xcb_screen_next(&screens);
+    }
+    xcb_screen_t *screen = screens.data;
+    xcb_window_t root = screen->root;
+
+    xcb_atom_t NET_ACTIVE_WINDOW = internAtom("_NET_ACTIVE_WINDOW");
+    xcb_atom_t NET_WM_NAME = internAtom("_NET_WM_NAME");
+    xcb_atom_t NET_WM_PID = internAtom("_NET_WM_PID");
+    xcb_atom_t UTF8_STRING = internAtom("UTF8_STRING");
+
+    // windows owned by this process, so the collector resolves their PID to our own /proc/<pid>/comm
+    uint32_t pid = static_cast<uint32_t>(getpid());
+    QVector<xcb_window_t> windows;
+    for (int i = 0; i < windowCount; i++) {
+        xcb_window_t window = xcb_generate_id(benchConnection);
+        xcb_create_window(benchConnection, XCB_COPY_FROM_PARENT, window, root, 0, 0, 100, 100, 0,
+                          XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual, 0, nullptr);
+        QByteArray title = "Window " + QByteArray::number(i);
+        xcb_change_property(benchConnection, XCB_PROP_MODE_REPLACE, window, NET_WM_NAME, UTF8_STRING, 8,
+                            static_cast<uint32_t>(title.size()), title.constData());
+        xcb_change_property(benchConnection, XCB_PROP_MODE_REPLACE, window, NET_WM_PID, XCB_ATOM_CARDINAL, 32, 1, &pid);
+        windows.append(window);
+    }
+    xcb_change_property(benchConnection, XCB_PROP_MODE_REPLACE, root, NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, &windows[0]);
+    xcb_flush(benchConnection);
+
+    MetricCounter &logged = Metrics::instance().counter("capture_events_total", "Activities reported by the collector");
+
+    WindowEvents_U collector; // the real collector, on its own thread like in the app
+    collector.start();
+    if (!waitForLog(logged, 0)) {
+        std::fprintf(stderr, "The collector logged nothing; is the X server reachable?\n");
+        collector.requestInterruption();
+        collector.wait();
+        return 1;
+    }
+    std::printf("startup: %llu round-trips (atoms, then the window active at start)\n", roundTrips.load());
+
+    RoundTripStats firstVisit("first visit");
+    RoundTripStats cachedVisit("cached window");
+    RoundTripStats titleChange("title change");
+    QVector<bool> visited(windowCount, false);
+    visited[0] = true;
+    int timeouts = 0;
+
+    for (int i = 1; i <= switchCount; i++) {
+        int index = i % windowCount;
+
+        quint64 loggedBefore = logged.value();
+        quint64 roundTripsBefore = roundTrips;
+        xcb_change_property(benchConnection, XCB_PROP_MODE_REPLACE, root, NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, &windows[index]);
+        xcb_flush(benchConnection);
+        if (!waitForLog(logged, loggedBefore)) {
+            timeouts++;
+            continue;
+        }
+        (visited[index] ? cachedVisit : firstVisit).add(roundTrips - roundTripsBefore);
+        visited[index] = true;
+
+        loggedBefore = logged.value();
+        roundTripsBefore = roundTrips;
+        QByteArray title = "Window " + QByteArray::number(index) + " - change " + QByteArray::number(i);
+        xcb_change_property(benchConnection, XCB_PROP_MODE_REPLACE, windows[index], NET_WM_NAME, UTF8_STRING, 8,
+                            static_cast<uint32_t>(title.size()), title.constData());
+        xcb_flush(benchConnection);
+        if (!waitForLog(logged, loggedBefore)) {
+            timeouts++;
+            continue;
+        }
+        titleChange.add(roundTrips - roundTripsBefore);
+    }
+
+    collector.requestInterruption();
+    collector.wait();
+    xcb_disconnect(benchConnection);
+
+    std::printf("\n%d windows, %d switches\n", windowCount, switchCount);
+    firstVisit.print();
+    cachedVisit.print();
+    titleChange.print();
+    if (timeouts > 0) {
+        std::printf("\n%d changes weren't logged within %d ms\n", timeouts, LOG_TIMEOUT_MS);
+    }
+    return timeouts > 0 ? 1 : 0;
+}
@@ -0,0 +1,250 @@
+#include "Tracing.h"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QTimer>
+
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#endif
+
+namespace
+{
+    // one span; every field is atomic, so a dump can read slots while their thread overwrites them
+    struct Slot
+    {
+        std::atomic<quint64> sequence{0}; // index + 1 of the span in it, 0 while it's being written
+        std::atomic<const char *> name{nullptr};
+        std::atomic<qint64> startNs{0};
+        std::atomic<qint64> durationNs{0};
+    };
+
+    // written by one thread at a time; a buffer, and its thread id in traces, is handed on when its thread ends,
+    // so pools that keep replacing their threads don't keep adding buffers
+    struct ThreadBuffer
+    {
+        Slot slots[TRACE_RING_SIZE];
+        std::atomic<quint64> written{0};
+        int threadId = 0;
+        // guarded by Registry::mutex
+        QString threadName;
+        bool inUse = false;
+    };
+
+    struct Registry
+    {
+        QMutex mutex; // guards the list, not the buffers' spans
+        std::vector<ThreadBuffer *> buffers;
+    };
+
+    Registry &registry()
+    {
+        static Registry *_registry = new Registry; // never destroyed, threads may end after main()
+        return *_registry;
+    }
+
+    std::atomic<bool> enabled{false};
+
+    qint64 clockNs()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        // +1, so a real timestamp is never 0
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count() + 1;
+    }
+
+    ThreadBuffer *claimBuffer()
+    {
+        Registry &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        ThreadBuffer *buffer = nullptr;
+        for (ThreadBuffer *candidate : reg.buffers) {
+            if (!candidate->inUse) {
+                buffer = candidate; // the spans of its previous thread stay until they're overwritten
+                break;
+            }
+        }
+        if (buffer == nullptr) {
+            buffer = new ThreadBuffer;
+            reg.buffers.push_back(buffer);
+            buffer->threadId = static_cast<int>(reg.buffers.size());
+        }
+        buffer->inUse = true;
+
+        QThread *thread = QThread::currentThread();
+        buffer->threadName = thread->objectName();
+        if (QCoreApplication::instance() != nullptr && thread == QCoreApplication::instance()->thread()) {
+            buffer->threadName = "GUI";
+        } else if (buffer->threadName.isEmpty()) {
+            buffer->threadName = QString("Thread %1").arg(buffer->threadId);
+        }
+        return buffer;
+    }
+
+    // gives the buffer back when its thread ends
+    struct BufferHolder
+    {
+        ThreadBuffer *buffer = nullptr;
+
+        ~BufferHolder()
+        {
+            if (buffer != nullptr) {
+                QMutexLocker locker(&registry().mutex);
+                buffer->inUse = false;
+            }
+        }
+    };
+
+    ThreadBuffer &threadBuffer()
+    {
+        static thread_local BufferHolder holder;
+        if (holder.buffer == nullptr) {
+            holder.buffer = claimBuffer();
+        }
+        return *holder.buffer;
+    }
+
+#ifdef Q_OS_UNIX
+    volatile sig_atomic_t dumpRequested = 0;
+
+    void dumpSignalHandler(int)
+    {
+        dumpRequested = 1; // nothing else is safe in a signal handler; the dump itself runs on the GUI thread
+    }
+#endif
+}
+
+bool Tracing::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Tracing::setEnabled(bool enable)
+{
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+qint64 Tracing::now()
+{
+    return isEnabled() ? clockNs() : 0;
+}
+
+void Tracing::record(const char *name, qint64 startNs, qint64 endNs)
+{
+    if (startNs == 0) {
+        return;
+    }
+    ThreadBuffer &buffer = threadBuffer();
+    quint64 index = buffer.written.load(std::memory_order_relaxed);
+    Slot &slot = buffer.slots[index % TRACE_RING_SIZE];
+
+    // a seqlock per slot: readers that see a different sequence before and after reading skip the slot
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.durationNs.store(endNs - startNs, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+QByteArray Tracing::toJson()
+{
+    Registry &reg = registry();
+    QMutexLocker locker(&reg.mutex);
+
+    QJsonArray events;
+    qint64 pid = QCoreApplication::applicationPid();
+    for (ThreadBuffer *buffer : reg.buffers) {
+        QJsonObject args;
+        args.insert("name", buffer->threadName);
+        QJsonObject metadata;
+        metadata.insert("name", "thread_name");
+        metadata.insert("ph", "M");
+        metadata.insert("pid", pid);
+        metadata.insert("tid", buffer->threadId);
+        metadata.insert("args", args);
+        events.append(metadata);
+
+        quint64 written = buffer->written.load(std::memory_order_acquire);
+        quint64 first = written > TRACE_RING_SIZE ? written - TRACE_RING_SIZE : 0;
+        for (quint64 index = first; index < written; index++) {
+            Slot &slot = buffer->slots[index % TRACE_RING_SIZE];
+            if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+                continue; // already overwritten
+            }
+            const char *name = slot.name.load(std::memory_order_relaxed);
+            qint64 startNs = slot.startNs.load(std::memory_order_relaxed);
+            qint64 durationNs = slot.durationNs.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != index + 1) {
+                continue; // overwritten while we read it
+            }
+
+            QJsonObject event;
+            event.insert("name", QString::fromLatin1(name));
+            event.insert("cat", "timecamp");
+            event.insert("ph", "X");
+            event.insert("ts", startNs / 1000.0); // microseconds
+            event.insert("dur", durationNs / 1000.0);
+            event.insert("pid", pid);
+            event.insert("tid", buffer->threadId);
+            events.append(event);
+        }
+    }
+
+    QJsonObject root;
+    root.insert("traceEvents", events);
+    root.insert("displayTimeUnit", "ms");
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool Tracing::dumpTo(const QString &path)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(toJson());
+    return file.commit();
+}
+
+void Tracing::dumpOnSignal(const QString &path)
+{
+#ifdef Q_OS_UNIX
+    auto *pollTimer = new QTimer(QCoreApplication::instance());
+    QObject::connect(pollTimer, &QTimer::timeout, [path]
+    {
+        if (!dumpRequested) {
+            return;
+        }
+        dumpRequested = 0;
+        if (dumpTo(path)) {
+            qInfo() << "[Tracing] Trace saved to" << path;
+        } else {
+            qWarning() << "[Tracing] Can't save trace to" << path;
+        }
+    });
+    pollTimer->start(1000);
+
+    struct sigaction action = {};
+    action.sa_handler = dumpSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+#else
+    Q_UNUSED(path);
+#endif
+}
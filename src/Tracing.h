@@ -0,0 +1,68 @@
+#ifndef TIMECAMPDESKTOP_TRACING_H
+#define TIMECAMPDESKTOP_TRACING_H
+
+#include <QByteArray>
+#include <QString>
+
+// Span tracing: where the time went, per thread, for the last few thousand spans of every thread.
+// A span is a name (a string literal, it's kept as a pointer) and a start and end on a monotonic clock;
+// spans are recorded into a fixed ring buffer of the thread that ran them and dumped on demand as
+// Chrome trace event JSON, which opens in https://ui.perfetto.dev and chrome://tracing.
+//
+//   void DbManager::saveAppToDb(AppData *app)
+//   {
+//       TRACE_SCOPE("DbManager::saveAppToDb");
+//       ...
+//
+// While tracing is disabled a span costs one relaxed atomic load; enabled, two clock reads and a few stores.
+
+#define TRACE_RING_SIZE 4096 // spans kept per thread
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+
+namespace Tracing
+{
+    bool isEnabled();
+    void setEnabled(bool enabled);
+
+    // nanoseconds on the trace clock; 0 while tracing is disabled
+    qint64 now();
+    // records a span that didn't fit a scope, like a request and its callback; ignored when startNs is 0
+    void record(const char *name, qint64 startNs, qint64 endNs);
+
+    // every span still in the ring buffers, as {"traceEvents": [...]}
+    QByteArray toJson();
+    // writes toJson(), replacing the file only when the whole of it is written
+    bool dumpTo(const QString &path);
+    // on SIGUSR1, dumps to this path within a second (Linux and macOS; call from the GUI thread)
+    void dumpOnSignal(const QString &path);
+}
+
+/**
+ * @brief Records the time from its construction to its destruction as a span; use TRACE_SCOPE
+ */
+class TraceSpan
+{
+    Q_DISABLE_COPY(TraceSpan)
+
+public:
+    explicit TraceSpan(const char *name)
+        : name(name), startNs(Tracing::now())
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (startNs != 0) {
+            Tracing::record(name, startNs, Tracing::now());
+        }
+    }
+
+private:
+    const char *name;
+    qint64 startNs;
+};
+
+#endif //TIMECAMPDESKTOP_TRACING_H
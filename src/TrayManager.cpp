@@ -1,13 +1,17 @@
 #include <QSystemTrayIcon>
 #include <QMessageBox>
 #include <QDesktopServices>
+#include <QDateTime>
 #include <unordered_map>
 
 #include "Settings.h"
+#include "SettingsSnapshot.h"
 #include "TrayManager.h"
 #include "MainWidget.h"
 
 #include "Autorun.h"
+#include "Metrics.h"
+#include "Tracing.h"
 
 TrayManager &TrayManager::instance() {
     static TrayManager _instance;
@@ -117,6 +121,7 @@ void TrayManager::tracker(bool checked) {
 void TrayManager::autoTracking(bool checked) {
     settings.setValue(SETT_TRACK_AUTO_SWITCH, checked);
     settings.sync();
+    SettingsService::instance().reload();
 }
 
 #ifdef _WIDGET_EXISTS_
@@ -149,6 +154,29 @@ void TrayManager::contactSupport() {
     QDesktopServices::openUrl(mail);
 };
 
+void TrayManager::saveDiagnostics() {
+    QString suffix = QDateTime::currentDateTime().toString("yyyy_MM_dd__hh_mm_ss") + ".json";
+    QString path = Metrics::exportFolder() + "/metrics_" + suffix;
+    QString tracePath = Metrics::exportFolder() + "/trace_" + suffix; // opens in ui.perfetto.dev
+    bool saved = Metrics::instance().exportTo(path);
+    if (saved) {
+        qInfo() << "[Diagnostics] Metrics saved to" << path;
+    } else {
+        qWarning() << "[Diagnostics] Can't save metrics to" << path;
+    }
+    if (Tracing::isEnabled()) {
+        if (Tracing::dumpTo(tracePath)) {
+            qInfo() << "[Diagnostics] Trace saved to" << tracePath;
+            saved = true;
+        } else {
+            qWarning() << "[Diagnostics] Can't save trace to" << tracePath;
+        }
+    }
+    if (saved) {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(Metrics::exportFolder()));
+    }
+}
+
 void TrayManager::createActions(QMenu *menu) {
     openAct = new QAction(tr("Show"), this);
     openAct->setStatusTip(tr("Opens TimeCamp interface"));
@@ -203,6 +231,10 @@ void TrayManager::createActions(QMenu *menu) {
     helpAct->setStatusTip(tr("Need help? Talk to one of our support gurus"));
     connect(helpAct, &QAction::triggered, this, &TrayManager::contactSupport);
 
+    diagnosticsAct = new QAction(tr("Save diagnostics"), this);
+    diagnosticsAct->setStatusTip(tr("Saves performance counters and traces for our support team"));
+    connect(diagnosticsAct, &QAction::triggered, this, &TrayManager::saveDiagnostics);
+
     quitAct = new QAction(tr("Quit"), this);
     quitAct->setStatusTip(tr("Close the app"));
     connect(quitAct, &QAction::triggered, mainWidget, &MainWidget::quit);
@@ -259,6 +291,7 @@ void TrayManager::assignActions(QMenu *menu) {
 #endif
     tempMenu->addSeparator();
     tempMenu->addAction(helpAct);
+    tempMenu->addAction(diagnosticsAct);
     tempMenu->addSeparator();
     tempMenu->addAction(quitAct);
 
@@ -60,6 +60,7 @@ public slots:
     void updateRecentTasks();
     void openCloseWindowAction();
     void contactSupport();
+    void saveDiagnostics();
 #ifdef _WIDGET_EXISTS_
     void widgetToggl(bool checked);
 #endif
@@ -83,6 +84,7 @@ private:
     QAction *autoStartAct;
     QAction *widgetAct;
     QAction *helpAct;
+    QAction *diagnosticsAct;
     QAction *quitAct;
 
     MainWidget *mainWidget;
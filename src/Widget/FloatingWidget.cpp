@@ -56,25 +56,9 @@ FloatingWidget::FloatingWidget(QWidget *parent)
     QMetaObject::Connection conn3 = QObject::connect(startStopLabel, &ClickableLabel::clicked,
                                                      this, &FloatingWidget::startStopClicked);
 
-    auto *oneSecondTimer = new QTimer();
-    QObject::connect(oneSecondTimer, &QTimer::timeout, this, &FloatingWidget::oneSecTimerTimeout);
-    oneSecondTimer->start(1000);
     updateWidgetStatus(false, "");
 }
 
-void FloatingWidget::oneSecTimerTimeout() {
-    if (timerElapsed > 0) {
-        QTime time(0,0,0);
-        time = time.addSecs(timerElapsed);
-        if (time.hour() > 0) {
-            this->setTimerText(time.toString("H:mm:ss"));
-        } else {
-            this->setTimerText(time.toString("m:ss"));
-        }
-        timerElapsed++;
-    }
-}
-
 void FloatingWidget::emitTaskNameClicked() {
     emit taskNameClicked();
 }
@@ -88,7 +72,6 @@ void FloatingWidget::updateWidgetStatus(bool canBeStopped, QString timerName) {
         timerRunning = false;
         this->setTimerText(""); // set empty text (no 0:00 for timer when no task is running)
         timerName = "No task";
-        timerElapsed = 0;
     }
     if (timerName.isEmpty()) {
         timerName = "No task";
@@ -293,7 +276,13 @@ void FloatingWidget::setIcon(QString iconPath) {
     // if it had, it would be in the left corner
 }
 
-void FloatingWidget::setTimerElapsed(int timerElapsed)
+void FloatingWidget::setTimerElapsed(qint64 timerElapsed)
 {
-    FloatingWidget::timerElapsed = timerElapsed;
+    // TCTimer sends this every second while a timer runs
+    if (!timerRunning || timerElapsed <= 0) {
+        return;
+    }
+    qint64 hours = timerElapsed / 3600;
+    QString minutesSeconds = QTime(0, 0, 0).addSecs(static_cast<int>(timerElapsed % 3600)).toString(hours > 0 ? "mm:ss" : "m:ss");
+    this->setTimerText(hours > 0 ? QString::number(hours) + ":" + minutesSeconds : minutesSeconds);
 }
@@ -31,7 +31,7 @@ public slots:
     void emitTaskNameClicked();
     void startStopClicked();
     void updateWidgetStatus(bool, QString);
-    void setTimerElapsed(int timerElapsed);
+    void setTimerElapsed(qint64 timerElapsed);
 
 signals:
     void taskNameClicked();
@@ -48,7 +48,6 @@ protected:
     bool mouseInGrip(QPoint mousePos);
 
 private:
-    int timerElapsed = 0;
     int radius = 4;
     int margin = 4;
     bool FloatingWidgetWasInitialised = false;
@@ -62,7 +61,6 @@ private:
     QSize gripSize;
     QSettings settings;
     int scaleToFit(double height);
-    void oneSecTimerTimeout();
 
     QLabel *timerTextLabel;
     ClickableLabel *taskTextLabel;
@@ -6,15 +6,7 @@
 
 #include "WindowEventsManager.h"
 #include "Settings.h"
-
-
-#ifdef Q_OS_LINUX
-#include "DataCollector/WindowEvents_U.h"
-#elif defined(Q_OS_WIN)
-#include "DataCollector/WindowEvents_W.h"
-#else
-#include "DataCollector/WindowEvents_M.h"
-#endif
+#include "DataCollector/CollectorRegistry.h"
 
 
 WindowEventsManager &WindowEventsManager::instance()
@@ -25,13 +17,7 @@ WindowEventsManager &WindowEventsManager::instance()
 
 WindowEventsManager::WindowEventsManager(QObject *parent) : QObject(parent)
 {
-#ifdef Q_OS_LINUX
-    captureEventsThread = new WindowEvents_U();
-#elif defined(Q_OS_WIN)
-    captureEventsThread = new WindowEvents_W();
-#else
-    captureEventsThread = new WindowEvents_M();
-#endif
+    captureEventsThread = CollectorRegistry::instance().createSelected(); // OS collector, unless chosen otherwise at startup
     QObject::connect(captureEventsThread, &WindowEvents::noLongerAway, this, &WindowEventsManager::noLongerAway);
 }
 
@@ -2,6 +2,7 @@
 #include <QTimer>
 #include <QStandardPaths>
 #include <QLibraryInfo>
+#include <QCommandLineParser>
 
 #ifdef Q_OS_MACOS
 
@@ -19,7 +20,14 @@
 #include "TCTimer.h"
 #include "DataCollector/WindowEvents.h"
 #include "WindowEventsManager.h"
+#include "DataCollector/CollectorRegistry.h"
+#include "DataCollector/ActivityTrace.h"
 #include "Widget/FloatingWidget.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "Tracing.h"
+#include "StartupProfile.h"
+#include "LogCategories.h"
 
 #include "third-party/vendor/de/skycoder42/qhotkey/QHotkey/qhotkey.h"
 #include "third-party/QTLogRotation/logutils.h"
@@ -37,8 +45,44 @@ void firstRun()
     settings.setValue(SETT_IS_FIRST_RUN, false);
 }
 
+void applyCommandLine()
+{
+    CollectorRegistry &registry = CollectorRegistry::instance();
+
+    QCommandLineParser parser;
+    QCommandLineOption collectorOption("collector", "Activity source: " + registry.collectorNames().join(", "),
+                                       "name", CollectorRegistry::defaultCollectorName());
+    QCommandLineOption replayTraceOption("replay-trace", "Trace file for the replay collector.", "file");
+    QCommandLineOption replaySpeedOption("replay-speed", "Replay speed multiplier; 0 replays as fast as possible.", "factor", "1");
+    QCommandLineOption replayLoopOption("replay-loop", "Start the trace over when it ends.");
+    QCommandLineOption startupProfileOption("startup-profile", "Write startup phase times (ms) to this JSON file "
+                                                               "once the first activity is captured, then quit.", "file");
+    QCommandLineOption captureTraceOption("capture-trace", "Record every logged activity to a binary trace file.", "file");
+    parser.addOptions({collectorOption, replayTraceOption, replaySpeedOption, replayLoopOption, startupProfileOption,
+                       captureTraceOption});
+
+    // parse() instead of process(), because QtWebEngine (Chromium) flags have to pass through untouched
+    parser.parse(QCoreApplication::arguments());
+
+    QVariantMap options;
+    options.insert("trace", parser.value(replayTraceOption));
+    options.insert("speed", parser.value(replaySpeedOption).toDouble());
+    options.insert("loop", parser.isSet(replayLoopOption));
+    registry.select(parser.value(collectorOption), options);
+
+    if (parser.isSet(startupProfileOption)) {
+        StartupProfile::reportAndQuitAt("first_activity", parser.value(startupProfileOption));
+    }
+
+    if (parser.isSet(captureTraceOption)) {
+        ActivityTrace::startCapture(parser.value(captureTraceOption));
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, &ActivityTrace::stopCapture);
+    }
+}
+
 int main(int argc, char *argv[])
 {
+    StartupProfile::begin();
 
     // Caches are saved in %localappdata%/org_name/APPLICATION_NAME
     // Eg. C:\Users\timecamp\AppData\Local\Time Solutions\TimeCamp Desktop
@@ -49,8 +93,12 @@ int main(int argc, char *argv[])
     QCoreApplication::setApplicationName(APPLICATION_NAME);
     QCoreApplication::setApplicationVersion(APPLICATION_VERSION);
 
-    // install log handler
-    LOGUTILS::initLogging();
+    // install log handler; binary logs keep days of history in the space of hours of text
+    bool binaryLog = QSettings().value(SETT_BINARY_LOG, false).toBool();
+    LOGUTILS::initLogging(true, binaryLog ? LOGUTILS::BinaryFormat : LOGUTILS::TextFormat);
+
+    // spans are cheap enough to keep on, so a trace of the last minutes is there when someone reports lag
+    Tracing::setEnabled(QSettings().value(SETT_TRACING, true).toBool());
 
     // Enable high dpi support
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
@@ -69,13 +117,15 @@ int main(int argc, char *argv[])
 
     // standard Qt init
     QApplication app(argc, argv);
+    StartupProfile::mark("qapplication");
 
-    // debugging library locations (most useful for Linux debugging)
+    // debugging library locations (most useful for Linux debugging); off in release builds, so none of
+    // the lookups run before the tray is up, QT_LOGGING_RULES="timecamp.startup.debug=true" turns them on
     for(int i = 0; i < 13; i++) {
-        qInfo() << "Location " << i << QLibraryInfo::location(QLibraryInfo::LibraryLocation(i));
+        qCDebug(lcStartup) << "Location " << i << QLibraryInfo::location(QLibraryInfo::LibraryLocation(i));
     }
-    qInfo() << "Loc: " << QCoreApplication::applicationDirPath() << '\n';
-    qInfo() << "qt.conf " << QDir(QCoreApplication::applicationDirPath()).exists("qt.conf") << '\n';
+    qCDebug(lcStartup) << "Loc: " << QCoreApplication::applicationDirPath() << '\n';
+    qCDebug(lcStartup) << "qt.conf " << QDir(QCoreApplication::applicationDirPath()).exists("qt.conf") << '\n';
 
     // check if it's a first run, and i.e. on Mac ask for permissions
     firstRun();
@@ -90,11 +140,15 @@ int main(int argc, char *argv[])
     appIcon.addFile(":/Icons/AppIcon_16.png");
     QApplication::setWindowIcon(appIcon);
 
+    qRegisterMetaType<TaskPtr>("TaskPtr"); // AutoTracking::foundTask can cross threads
+
     // create DB Manager instance early, as it needs some time to prepare queries etc
     DbManager *dbManager = &DbManager::instance();
     AutoTracking *autoTracking = &AutoTracking::instance();
+    StartupProfile::mark("db");
 
-    // create events manager
+    // create events manager, with the activity source chosen on command line
+    applyCommandLine();
     WindowEventsManager *windowEventsManager = &WindowEventsManager::instance();
 
     // create main widget
@@ -104,6 +158,7 @@ int main(int argc, char *argv[])
     // create tray manager
     TrayManager *trayManager = &TrayManager::instance();
     trayManager->setupTray(&mainWidget); // connect the mainWidget to tray
+    StartupProfile::mark("tray");
 
     QObject::connect(&mainWidget, &MainWidget::pageStatusChanged, trayManager, &TrayManager::loginLogout);
     QObject::connect(&mainWidget, &MainWidget::lastTasksChanged, trayManager, &TrayManager::updateRecentTasks);
@@ -125,7 +180,7 @@ int main(int argc, char *argv[])
     QObject::connect(comms, &Comms::DbSaveApp, dbManager, &DbManager::saveAppToDb);
     QObject::connect(comms, &Comms::DbSaveApp, autoTracking, &AutoTracking::checkAppKeywords);
 
-    // 2 sec timer for updating submenu and other features
+    // 2 sec timer for idle checks
     auto *twoSecondTimer = new QTimer();
     QObject::connect(twoSecondTimer, &QTimer::timeout, &mainWidget, &MainWidget::twoSecTimerTimeout);
     // above timeout triggers func that emits checkIsIdle when logged in
@@ -152,7 +207,6 @@ int main(int argc, char *argv[])
 
     // the timer that syncs via API
     auto *TimeCampTimer = new TCTimer(comms);
-    QObject::connect(syncDBtimer, &QTimer::timeout, TimeCampTimer, &TCTimer::status); // checking Timer Status on the same interval as DB Sync
 
     // Hotkeys
     auto hotkeyNewTimer = new QHotkey(QKeySequence(KB_SHORTCUTS_START_TIMER), true, &app);
@@ -192,16 +246,53 @@ int main(int argc, char *argv[])
     QObject::connect(TimeCampTimer, &TCTimer::timerStatusChanged, &mainWidget, &MainWidget::shouldRefreshTimerStatus);
     QObject::connect(TimeCampTimer, &TCTimer::timerElapsedSeconds, theWidget, &FloatingWidget::setTimerElapsed);
 
-    QObject::connect(&mainWidget, &MainWidget::updateTimerStatus, TimeCampTimer, &TCTimer::timerStatusReply);
+    QObject::connect(&mainWidget, &MainWidget::updateTimerStatus, TimeCampTimer, &TCTimer::pageTimerChanged);
 
     trayManager->setWidget(theWidget);
-    trayManager->setupSettings();
-    comms->timedUpdates(); // fetch userInfo, userSettings, send apps since last update
-    mainWidget.init(); // init the WebView
+    trayManager->setupSettings(); // starts the collector
+    StartupProfile::mark("capture");
+
+    // keep a recent metrics snapshot on disk, for support to ask for
+    auto *metricsExportTimer = new QTimer();
+    QObject::connect(metricsExportTimer, &QTimer::timeout, []
+    {
+        Metrics::instance().exportTo(Metrics::exportFolder() + "/metrics.json");
+    });
 
     // now timers
     syncDBtimer->start(30 * 1000); // sync DB every 30s
     twoSecondTimer->start(2 * 1000);
+    metricsExportTimer->start(5 * 60 * 1000);
+
+    // the tray is up and activities are captured; the rest waits for the event loop, so it doesn't hold them up:
+    // first the sync, then QtWebEngine, which takes seconds to start.
+    // The sync stays on this thread: Comms waits for each reply in a nested QEventLoop on the one QNetworkAccessManager
+    // it shares with TCTimer and the 30s sync, and neither is thread-safe; the tray and widget are served meanwhile.
+    QTimer::singleShot(0, &app, [comms, TimeCampTimer, &mainWidget]
+    {
+        StartupProfile::mark("event_loop");
+        comms->timedUpdates(); // fetch userInfo, userSettings, send apps since last update
+        TimeCampTimer->status(); // then TCTimer counts on its own, and checks again every few minutes
+        StartupProfile::mark("first_sync");
+
+        QTimer::singleShot(0, &mainWidget, [&mainWidget]
+        {
+            mainWidget.init(); // init the WebView
+            StartupProfile::mark("webview");
+        });
+    });
+
+    // kill -USR1 <pid> saves the trace without going through the (maybe stuck) tray menu
+    Tracing::dumpOnSignal(Metrics::exportFolder() + "/trace.json");
+
+    // opt-in, for fleets that scrape their workstations
+    QSettings settings;
+    if (settings.value(SETT_METRICS_ENDPOINT, false).toBool()) {
+        MetricsServer::instance().start(static_cast<quint16>(settings.value(SETT_METRICS_PORT, DEFAULT_METRICS_PORT).toUInt()));
+    }
 
-    return QApplication::exec();
+    int result = QApplication::exec();
+    Metrics::instance().exportTo(Metrics::exportFolder() + "/metrics.json");
+    LOGUTILS::shutdownLogging(); // write out what's still queued
+    return result;
 }
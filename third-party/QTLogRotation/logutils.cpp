@@ -1,8 +1,14 @@
 #include "logutils.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #include <QTime>
 #include <QFile>
@@ -10,17 +16,105 @@
 #include <QDebug>
 #include <QDir>
 #include <QFileInfoList>
+#include <QDateTime>
+
+#include "src/BinaryLog.h"
+#include "src/Metrics.h"
 
 namespace LOGUTILS {
     static QString logFileName;
     static QString logFolderName;
-    QString lastMessage;
-    qint64 sameMessageCount = 0;
+
+    namespace {
+        struct LogEntry {
+            std::atomic<LogEntry *> next{nullptr};
+            qint64 msSinceEpoch = 0;
+            QtMsgType type = QtDebugMsg;
+            const char *category = nullptr; // category names are string literals
+            QString msg;
+        };
+
+        /**
+         * Dmitry Vyukov's intrusive MPSC queue: push() is one atomic exchange and can be called from any thread,
+         * pop() only from the single consumer. pop() can return nullptr for a moment while a push is half done.
+         */
+        class LogQueue {
+        public:
+            LogQueue() : head(&stub), tail(&stub) {}
+
+            void push(LogEntry *entry) {
+                entry->next.store(nullptr, std::memory_order_relaxed);
+                LogEntry *previous = head.exchange(entry, std::memory_order_seq_cst);
+                previous->next.store(entry, std::memory_order_release);
+            }
+
+            LogEntry *pop() {
+                LogEntry *first = tail;
+                LogEntry *next = first->next.load(std::memory_order_acquire);
+                if (first == &stub) {
+                    if (next == nullptr) {
+                        return nullptr;
+                    }
+                    tail = next;
+                    first = next;
+                    next = next->next.load(std::memory_order_acquire);
+                }
+                if (next != nullptr) {
+                    tail = next;
+                    return first;
+                }
+                if (first != head.load(std::memory_order_acquire)) {
+                    return nullptr; // a producer is between its exchange and linking the entry
+                }
+                push(&stub);
+                next = first->next.load(std::memory_order_acquire);
+                if (next != nullptr) {
+                    tail = next;
+                    return first;
+                }
+                return nullptr;
+            }
+
+            bool hasPending() const {
+                return head.load(std::memory_order_seq_cst) != tail || tail->next.load(std::memory_order_acquire) != nullptr;
+            }
+
+        private:
+            std::atomic<LogEntry *> head;
+            LogEntry *tail;
+            LogEntry stub;
+        };
+
+        LogQueue queue;
+        std::thread logThread;
+        std::atomic<bool> accepting{false}; // messages are queued for the log thread
+        std::atomic<int> activeProducers{0}; // threads between checking `accepting` and finishing their push
+        std::atomic<bool> running{false}; // the log file and encoder are in use, until shutdownLogging has closed them
+        std::atomic<bool> stopRequested{false};
+        std::atomic<bool> consumerSleeping{false};
+        std::mutex wakeMutex;
+        std::condition_variable wakeCondition;
+        bool wakeRequested = false;
+        bool echo = true;
+        Format format = TextFormat;
+        std::mutex directWriteMutex;
+
+        // used by the log thread only (and by shutdownLogging once it's gone)
+        QFile logFile;
+        qint64 logFileSize = 0;
+        QString lastMessage;
+        qint64 sameMessageCount = 0;
+        BinaryLogEncoder encoder;
+
+        const int maxBatchBytes = 64 * 1024;
+        const std::chrono::milliseconds idleWakeUp(500);
+    }
 
     void initLogFileName() {
-        logFileName = QString(logFolderName + "/Log_%1__%2.txt")
+        logFileName = QString(logFolderName + "/Log_%1__%2.%3")
             .arg(QDate::currentDate().toString("yyyy_MM_dd"))
-            .arg(QTime::currentTime().toString("hh_mm_ss_zzz"));
+            .arg(QTime::currentTime().toString("hh_mm_ss_zzz"))
+            .arg(format == BinaryFormat ? "tclog" : "txt");
     }
 
     /**
@@ -44,53 +138,18 @@ namespace LOGUTILS {
         }
     }
 
-    bool initLogging() {
-        // Create folder for logfiles if not exists
-        logFolderName = QStandardPaths::standardLocations(QStandardPaths::AppLocalDataLocation).first() + "/logs";
-
-        if (!QDir(logFolderName).exists()) {
-            QDir().mkdir(logFolderName);
-        }
-
-        std::cout << "[LOG PATH] " << logFolderName.toStdString() << std::endl;
-
-        deleteOldLogs(); //delete old log files
-        initLogFileName(); //create the logfile name
-
-        QFile outFile(logFileName);
-        if (outFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-            qInstallMessageHandler(LOGUTILS::myMessageHandler);
-            return true;
-        } else {
-            return false;
-        }
-    }
-
-    void myMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
-        //check file size and if needed create new log!
-        {
-            QFile outFileCheck(logFileName);
-            qint64 size = outFileCheck.size();
-
-            if (size > LOGSIZE) //check current log size
-            {
-                deleteOldLogs();
-                initLogFileName();
-            }
-        }
-
-
-        const std::time_t stdtime = std::time(nullptr);
-//    std::cout << "UTC:       " << std::put_time(std::gmtime(&stdtime), "%H:%M:%S") << '\n';
-//    std::cout << "local:     " << std::put_time(std::localtime(&stdtime), "%H:%M:%S") << '\n';
+    static QString formatLine(qint64 msSinceEpoch, QtMsgType type, const QString &msg) {
         char timestring[100];
+        std::time_t stdtime = static_cast<std::time_t>(msSinceEpoch / 1000);
 
 #ifdef Q_OS_WIN
         struct tm buf;
-      gmtime_s(&buf, &stdtime);
-      std::strftime(timestring, sizeof(timestring), "%H:%M:%S", &buf);
+        gmtime_s(&buf, &stdtime);
+        std::strftime(timestring, sizeof(timestring), "%H:%M:%S", &buf);
 #else
-        std::strftime(timestring, sizeof(timestring), "%H:%M:%S", std::gmtime(&stdtime)); // UTC, localtime for local
+        struct tm buf;
+        gmtime_r(&stdtime, &buf); // UTC, localtime for local
+        std::strftime(timestring, sizeof(timestring), "%H:%M:%S", &buf);
 #endif
 
         QString txt;
@@ -114,23 +173,246 @@ namespace LOGUTILS {
                 txt += QString("Fatal:\t%1").arg(msg);
                 break;
         }
+        return txt;
+    }
+
+    static bool openLogFile() {
+        logFile.setFileName(logFileName);
+        if (!logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            return false;
+        }
+        logFileSize = logFile.size();
+        if (format == BinaryFormat && logFileSize == 0) {
+            logFileSize = logFile.write(encoder.begin(QDateTime::currentMSecsSinceEpoch()));
+        }
+        return true;
+    }
 
-        QFile outFile(logFileName);
-        outFile.open(QIODevice::WriteOnly | QIODevice::Append);
-        QTextStream ts(&outFile);
-        if(msg != lastMessage || sameMessageCount > 20) {
-            if(sameMessageCount > 0){
-                QString repeated;
-                repeated.append("^ repeated x").append(QString::number(sameMessageCount));
-                ts << repeated << endl;
-                std::cout << repeated.toStdString() << std::endl;
+    // text goes to the file in text format only, and to the console when echoing
+    static void appendLine(const QString &line, QByteArray &fileBatch, std::string &consoleBatch) {
+        QByteArray utf8 = line.toUtf8();
+        if (format == TextFormat) {
+            fileBatch += utf8;
+            fileBatch += '\n';
+        }
+        if (echo) {
+            consoleBatch.append(utf8.constData(), static_cast<size_t>(utf8.size()));
+            consoleBatch += '\n';
+        }
+    }
+
+    static void appendRepeated(QByteArray &fileBatch, std::string &consoleBatch) {
+        if (format == BinaryFormat) {
+            encoder.appendRepeat(fileBatch, static_cast<quint64>(sameMessageCount));
+        }
+        if (format == TextFormat || echo) {
+            appendLine(QString("^ repeated x") + QString::number(sameMessageCount), fileBatch, consoleBatch);
+        }
+    }
+
+    // identical messages in a row are written once, followed by how many times they repeated
+    static void appendEntry(const LogEntry &entry, QByteArray &fileBatch, std::string &consoleBatch) {
+        if (entry.msg != lastMessage || sameMessageCount > 20) {
+            if (sameMessageCount > 0) {
+                appendRepeated(fileBatch, consoleBatch);
+            }
+            if (format == BinaryFormat) {
+                encoder.appendEvent(fileBatch, entry.msSinceEpoch, entry.type, entry.category, entry.msg);
+            }
+            if (format == TextFormat || echo) {
+                appendLine(formatLine(entry.msSinceEpoch, entry.type, entry.msg), fileBatch, consoleBatch);
             }
-            ts << txt << endl;
-            std::cout << txt.toStdString() << std::endl;
             sameMessageCount = 0;
         } else {
             sameMessageCount++;
         }
-        lastMessage = msg;
+        lastMessage = entry.msg;
+    }
+
+    static void writeBatch(QByteArray &fileBatch, std::string &consoleBatch) {
+        static MetricCounter &bytesWritten = Metrics::instance().counter("log_bytes_written_total", "Bytes written to log files");
+        static MetricHistogram &writeTime = Metrics::instance().histogram("log_batch_write_us", "Writing one batch of log messages to the file");
+        if (!fileBatch.isEmpty() && logFile.isOpen()) {
+            MetricTimer timer(writeTime);
+            bytesWritten.add(static_cast<quint64>(fileBatch.size()));
+            logFile.write(fileBatch);
+            logFile.flush();
+            logFileSize += fileBatch.size();
+
+            // rotate; the size is tracked here, not asked from the file system
+            if (logFileSize > LOGSIZE || (format == BinaryFormat && encoder.isFull())) {
+                logFile.close();
+                deleteOldLogs();
+                initLogFileName();
+                openLogFile();
+            }
+        }
+        if (!consoleBatch.empty()) {
+            std::fwrite(consoleBatch.data(), 1, consoleBatch.size(), stdout);
+            std::fflush(stdout);
+        }
+        fileBatch.clear();
+        consoleBatch.clear();
+    }
+
+    static void drainQueue(QByteArray &fileBatch, std::string &consoleBatch) {
+        static MetricCounter &written = Metrics::instance().counter("log_messages_written_total", "Log messages taken off the queue and written");
+        while (LogEntry *entry = queue.pop()) {
+            written.add();
+            appendEntry(*entry, fileBatch, consoleBatch);
+            delete entry;
+            if (fileBatch.size() > maxBatchBytes) {
+                writeBatch(fileBatch, consoleBatch);
+            }
+        }
+        writeBatch(fileBatch, consoleBatch);
+    }
+
+    static void logThreadMain() {
+        QByteArray fileBatch;
+        std::string consoleBatch;
+        fileBatch.reserve(maxBatchBytes + 4096);
+
+        for (;;) {
+            bool stopping = stopRequested.load(std::memory_order_acquire);
+            drainQueue(fileBatch, consoleBatch);
+            if (stopping) {
+                return; // everything queued before the stop request is written
+            }
+
+            // producers wake us up only while this flag is set, so most messages cost them no syscall
+            consumerSleeping.store(true, std::memory_order_seq_cst);
+            if (!queue.hasPending() && !stopRequested.load(std::memory_order_acquire)) {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wakeCondition.wait_for(lock, idleWakeUp, [] { return wakeRequested; });
+                wakeRequested = false;
+            }
+            consumerSleeping.store(false, std::memory_order_seq_cst);
+        }
+    }
+
+    static void wakeLogThread() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeRequested = true;
+        }
+        wakeCondition.notify_one();
+    }
+
+    // while shutdownLogging is still writing what was queued, the file and the encoder are not ours to touch
+    static void waitForShutdown() {
+        while (running.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // before initLogging and after shutdownLogging: open, write, close, like it used to be.
+    // A binary log only gets these after shutdown, when the encoder is no longer used by the log thread
+    static void writeDirectly(QtMsgType type, const char *category, const QString &msg) {
+        std::lock_guard<std::mutex> lock(directWriteMutex);
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        QByteArray line = formatLine(now, type, msg).toUtf8() + '\n';
+        if (!logFileName.isEmpty() && (format == TextFormat || !running.load())) {
+            QFile outFile(logFileName);
+            if (outFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+                if (format == BinaryFormat) {
+                    QByteArray record;
+                    encoder.appendEvent(record, now, type, category, msg);
+                    outFile.write(record);
+                } else {
+                    outFile.write(line);
+                }
+            }
+        }
+        if (echo) {
+            std::fwrite(line.constData(), 1, static_cast<size_t>(line.size()), stdout);
+            std::fflush(stdout);
+        }
+    }
+
+    bool initLogging(bool echoToConsole, Format logFormat) {
+        // Create folder for logfiles if not exists
+        logFolderName = QStandardPaths::standardLocations(QStandardPaths::AppLocalDataLocation).first() + "/logs";
+
+        if (!QDir(logFolderName).exists()) {
+            QDir().mkpath(logFolderName);
+        }
+
+        echo = echoToConsole;
+        format = logFormat;
+        if (echo) {
+            std::cout << "[LOG PATH] " << logFolderName.toStdString() << std::endl;
+        }
+
+        deleteOldLogs(); //delete old log files
+        initLogFileName(); //create the logfile name
+
+        if (!openLogFile()) {
+            return false;
+        }
+        stopRequested.store(false);
+        running.store(true, std::memory_order_release);
+        logThread = std::thread(logThreadMain);
+        accepting.store(true, std::memory_order_release);
+        qInstallMessageHandler(LOGUTILS::myMessageHandler);
+        return true;
+    }
+
+    void shutdownLogging() {
+        if (!accepting.exchange(false)) {
+            return;
+        }
+        // a producer that saw `accepting` before it was cleared gets its push in before the final drain
+        while (activeProducers.load() != 0) {
+            std::this_thread::yield();
+        }
+        stopRequested.store(true, std::memory_order_release);
+        wakeLogThread();
+        if (logThread.joinable()) {
+            logThread.join();
+        }
+
+        // the log thread is gone, this thread is the consumer now: take what came in while it was stopping
+        QByteArray fileBatch;
+        std::string consoleBatch;
+        drainQueue(fileBatch, consoleBatch);
+        if (sameMessageCount > 0) {
+            appendRepeated(fileBatch, consoleBatch);
+            sameMessageCount = 0;
+        }
+        writeBatch(fileBatch, consoleBatch);
+        logFile.close();
+        running.store(false, std::memory_order_release); // from now on, messages are written directly
+    }
+
+    void myMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
+        if (std::this_thread::get_id() == logThread.get_id()) {
+            writeDirectly(type, context.category, msg); // text only; the encoder belongs to this thread's drainQueue
+            return;
+        }
+        activeProducers.fetch_add(1); // seq_cst, paired with the exchange and the load in shutdownLogging
+        if (!accepting.load()) {
+            activeProducers.fetch_sub(1);
+            waitForShutdown();
+            writeDirectly(type, context.category, msg);
+            return;
+        }
+
+        // the caller only pays for the copy and the exchange, formatting and I/O happen on the log thread
+        static MetricCounter &queued = Metrics::instance().counter("log_messages_queued_total", "Log messages queued for the log thread");
+        queued.add();
+        auto *entry = new LogEntry;
+        entry->msSinceEpoch = QDateTime::currentMSecsSinceEpoch();
+        entry->type = type;
+        entry->category = context.category;
+        entry->msg = msg;
+        queue.push(entry);
+        activeProducers.fetch_sub(1);
+
+        if (type == QtFatalMsg) {
+            shutdownLogging(); // the process aborts right after this returns
+        } else if (consumerSleeping.exchange(false, std::memory_order_seq_cst)) {
+            wakeLogThread();
+        }
     }
 }
@@ -2,7 +2,7 @@
 #define LOGUTILS_H
 
 // courtesy of https://andydunkel.net/2017/11/08/qt_log_file_rotation_with_qdebug/
-// slightly modified
+// slightly modified: messages are queued and written by a background thread, see logutils.cpp
 
 #define LOGSIZE 1024 * 1024 * 5 //log size in bytes - 5MB
 #define LOGFILES 10
@@ -15,7 +15,14 @@
 #include <QStandardPaths>
 
 namespace LOGUTILS {
-    bool initLogging();
+    enum Format {
+        TextFormat, // Log_*.txt
+        BinaryFormat // Log_*.tclog, see src/BinaryLog.h; read them with TimeCampLogDecoder
+    };
+
+    bool initLogging(bool echoToConsole = true, Format format = TextFormat);
+    // writes out everything still queued and stops the log thread; later messages are written directly
+    void shutdownLogging();
 
     void myMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg);
 